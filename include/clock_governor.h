@@ -0,0 +1,15 @@
+/*
+ * Copyright 2025, Hiroyuki OYAMA
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+#pragma once
+
+#include <stdint.h>
+
+void clock_governor_init(void);
+// Hold the clock at a level where `cycles` per frame fits while an effect is engaged; 0 releases.
+void clock_governor_reserve(uint32_t cycles);
+void clock_governor_record(uint32_t dsp_cycles);
+void clock_governor_update(void);
+uint32_t clock_governor_khz(void);
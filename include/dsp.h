@@ -0,0 +1,80 @@
+/*
+ * Copyright 2025, Hiroyuki OYAMA
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Per-target kernels are chosen at compile time. The portable dsp_ref_* versions are always
+// built so the target variants can be checked against them. tools/dsptest forces the variant
+// to test it on the host with the intrinsics emulated.
+#ifndef DSP_VARIANT_M33
+#if defined(PICO_RP2350) && PICO_RP2350 && defined(__ARM_FEATURE_DSP) && defined(__ARM_FP)
+#define DSP_VARIANT_M33 1
+#else
+#define DSP_VARIANT_M33 0
+#endif
+#endif
+
+// Largest difference allowed between the selected variant and the reference, in 24-bit LSBs,
+// as measured with tools/dsptest on dsp_selftest()'s input. The sweep over the LPF's settings
+// in tools/dsptest has its own bound: at a 500 Hz cutoff the resonant cascade amplifies the
+// rounding of the fused taps.
+#define DSP_BIQUAD_TOLERANCE_LSB 10
+#define DSP_BIQUAD_SWEEP_TOLERANCE_LSB 488
+#define DSP_RESAMPLE_TOLERANCE_LSB 1
+#define DSP_CROSSFADE_TOLERANCE_LSB 0
+
+#define DSP_GAIN_UNITY 32768  // Q15 crossfade gain
+
+// Level accumulator for one channel, filled by the kernels that write final output samples.
+typedef struct {
+    uint32_t peak;    // largest |sample| in 24-bit units
+    uint64_t sum_sq;  // sum of squared 16-bit magnitudes
+} dsp_level_t;
+
+static inline void dsp_level_add(dsp_level_t *level, int32_t sample) {
+    uint32_t mag = (uint32_t)(sample < 0 ? ~sample : sample) >> 8;
+    if (mag > level->peak)
+        level->peak = mag;
+    uint32_t mag16 = mag >> 7;
+    level->sum_sq += mag16 * mag16;
+}
+
+typedef struct {
+    float b0, b1, b2;
+    float a1, a2;
+    float c1, c2;  // b1 - a1, b2 - a2: folded taps used by the target kernels
+    float z1, z2;
+} dsp_biquad_t;
+
+void dsp_biquad_lowpass(dsp_biquad_t *bq, float fs, float fc, float q);
+void dsp_biquad_reset(dsp_biquad_t *bq);
+
+// Run `frames` samples spaced `stride` apart through `n_stages` biquads in series, in place.
+// The output is metered into `level` unless it is NULL.
+void dsp_biquad_cascade(int32_t *buf, size_t frames, size_t stride, dsp_biquad_t *stages,
+                        size_t n_stages, dsp_level_t *level);
+// Linear-interpolate `frames` stereo frames out of a stereo ring starting at `pos` and
+// advancing by `speed`; returns the new position.
+float dsp_resample(int32_t *out, const int32_t *ring, size_t ring_frames, float pos, float speed,
+                   size_t frames);
+// out = from * (1 - g) + to * g for stereo frames, g starting at `gain` (Q15) and moving by
+// `step` per frame, clamped to [0, DSP_GAIN_UNITY]; returns the gain after the last frame.
+// The output is metered into `levels[channel]` unless it is NULL.
+int32_t dsp_crossfade(int32_t *out, const int32_t *from, const int32_t *to, size_t frames,
+                      int32_t gain, int32_t step, dsp_level_t *levels);
+
+void dsp_ref_biquad_cascade(int32_t *buf, size_t frames, size_t stride, dsp_biquad_t *stages,
+                            size_t n_stages, dsp_level_t *level);
+float dsp_ref_resample(int32_t *out, const int32_t *ring, size_t ring_frames, float pos,
+                       float speed, size_t frames);
+int32_t dsp_ref_crossfade(int32_t *out, const int32_t *from, const int32_t *to, size_t frames,
+                          int32_t gain, int32_t step, dsp_level_t *levels);
+
+const char *dsp_variant(void);
+bool dsp_selftest(void);  // true if every kernel is within tolerance
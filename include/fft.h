@@ -0,0 +1,39 @@
+/*
+ * Copyright 2025, Hiroyuki OYAMA
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define FFT_LOG2_SIZE 8
+#define FFT_SIZE (1 << FFT_LOG2_SIZE)
+#define FFT_STEPS (FFT_LOG2_SIZE + 1)  // bit reversal + one step per radix-2 stage
+
+typedef struct {
+    int32_t re, im;
+} fft_complex_t;
+
+// In-place radix-2 FFT over data with complex magnitudes below 2^16, with block floating point: a
+// stage is scaled by 1/2 only when its input could overflow, and the shifts are counted in
+// `exponent`. The transform is split into FFT_STEPS steps of similar cost so callers can
+// spread it across audio frames.
+typedef struct {
+    fft_complex_t *data;
+    int step;
+    int exponent;  // true unnormalised DFT = data * 2^exponent
+    int32_t peak;  // OR of all |components|: its top bit is the largest one's
+    bool inverse;
+} fft_t;
+
+void fft_init(void);
+void fft_begin(fft_t *fft, fft_complex_t *data, bool inverse);
+bool fft_step(fft_t *fft);  // returns true once the transform is complete
+void fft_run(fft_t *fft);
+
+// Unit phasor e^(j 2 pi index / FFT_SIZE) in Q15
+void fft_phasor(uint32_t index, int32_t *cos_q15, int32_t *sin_q15);
+// Periodic Hann window in Q15
+int32_t fft_window(uint32_t n);
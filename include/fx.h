@@ -3,7 +3,37 @@
 #include <stdbool.h>
 #include <stdint.h>
 
+// Tunable parameters, persisted by the preset store. Their meaning is effect specific; an
+// effect must accept any stored values and clamp them to its own range.
+#define FX_NUM_PARAMS 4
+typedef struct {
+    int32_t values[FX_NUM_PARAMS];
+} fx_params_t;
+
 const char *fx_name(void);
 void fx_init(void);
 void fx_set_enable(bool enable);
+// output may alias input: the pipeline processes frames in place in the ring. The pass that
+// writes the final output samples also meters them into meter_levels().
 void fx_process(uint8_t *output, uint8_t *input);
+uint32_t fx_cycles_per_frame(void);
+// True when the effect has returned to rest. The pipeline then crossfades from fx_process()
+// output back to the dry signal over a few frames and after that stops calling fx_process():
+// an idle effect receives no frames at all. Whatever it still plays must either come out of
+// fx_process() during that fade or be faded out by the effect before it reports idle.
+// History kept across frames goes stale meanwhile, so when this turns false again the effect
+// must resync it (playheads to the write position, old audio dropped) and resume with the same
+// (zero) latency as the dry signal.
+bool fx_is_idle(void);
+// True when a silent input frame may still produce non-silent output (filter ring-out, loop
+// playback, delay history) or must still be fed to the effect.
+bool fx_has_tail(void);
+// Effect specific state reported with the meters: TapeStop speed (Q16), LPF cutoff (Hz),
+// Stutter loop position (samples).
+uint32_t fx_status(void);
+// Algorithmic delay of the wet signal in samples, reported to the host as part of the device
+// latency. The dry path is not delayed to match, so it should stay constant for an effect.
+uint32_t fx_latency_samples(void);
+void fx_get_params(fx_params_t *params);
+// Called between frames from the control path; may be slow (table rebuilds).
+void fx_set_params(const fx_params_t *params);
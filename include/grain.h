@@ -0,0 +1,37 @@
+/*
+ * Copyright 2025, Hiroyuki OYAMA
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define GRAIN_POOL_SIZE 16
+#define GRAIN_LENGTH 1024  // samples per grain
+#define GRAIN_WINDOW_SIZE 256
+
+typedef struct {
+    uint32_t pos;   // history read position, Q16 frames
+    uint32_t step;  // playback rate, Q16
+    uint32_t age;   // frames played; GRAIN_LENGTH once the slot is free
+} grain_t;
+
+// Fixed-capacity grain pool: all slots are preallocated and recycled, nothing is allocated
+// while audio runs.
+typedef struct {
+    grain_t grains[GRAIN_POOL_SIZE];
+    uint32_t active;
+    uint32_t stolen;  // grains cut short to make room for a new one
+} grain_pool_t;
+
+void grain_init(void);
+void grain_pool_reset(grain_pool_t *pool);
+// Take a slot for a new grain. Once `limit` grains are playing, the one closest to its end,
+// where the window is quietest, is stolen.
+grain_t *grain_alloc(grain_pool_t *pool, uint32_t limit);
+// Add `frames` stereo frames of every active grain, windowed, into `mix` at 24-bit scale.
+// `history` is an interleaved stereo ring of 16-bit samples, `history_frames` a power of two.
+void grain_render(grain_pool_t *pool, int32_t *mix, const int16_t *history,
+                  uint32_t history_frames, size_t frames);
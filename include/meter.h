@@ -0,0 +1,33 @@
+/*
+ * Copyright 2025, Hiroyuki OYAMA
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "dsp.h"
+#include "ringbuffer.h"
+
+#define METER_REPORT_FRAMES 50  // one report every 50 ms
+#define METER_REPORT_VERSION 1
+
+#define METER_FLAG_FX_ACTIVE 0x01  // the effect is running (not bypassed)
+
+// Little-endian report sent on the vendor IN endpoint; see tools/fx_meter.py.
+typedef struct __attribute__((packed)) {
+    uint8_t version;
+    uint8_t flags;
+    uint16_t sequence;
+    uint32_t peak[AUDIO_NUM_CHANNELS];  // 24-bit full scale = 0x7fffff
+    uint32_t rms[AUDIO_NUM_CHANNELS];   // same scale as peak
+    uint32_t fx_status;                 // effect specific, see fx_status()
+} meter_report_t;
+
+void meter_begin_frame(void);
+dsp_level_t *meter_levels(void);
+void meter_scan(const uint8_t *frame);
+void meter_end_frame(void);
+bool meter_take_report(meter_report_t *report);
@@ -0,0 +1,38 @@
+/*
+ * Copyright 2025, Hiroyuki OYAMA
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+#pragma once
+
+#include <stdint.h>
+
+typedef enum {
+    PERF_STAT_DISPATCH_US,  // frame arrival -> start of fx_process
+    PERF_STAT_OUTPUT_US,    // frame arrival -> handed to the IN endpoint
+    PERF_STAT_DSP_CYCLES,   // cycles spent in the effect pipeline per frame
+    PERF_STAT_FX_CYCLES,    // cycles per frame on which fx_process() actually ran
+    PERF_NUM_STATS,
+} perf_stat_id_t;
+
+typedef enum {
+    PERF_COUNTER_RX_DROPPED,   // OUT frame dropped because the RX ring was full
+    PERF_COUNTER_TX_UNDERRUN,  // IN frame filled with silence because the TX ring was empty
+    PERF_COUNTER_FX_BYPASSED,  // frame passed straight through while the effect was idle
+    PERF_COUNTER_FX_SILENT,    // silent input frame skipped while the effect had no tail
+    PERF_NUM_COUNTERS,
+} perf_counter_id_t;
+
+typedef struct {
+    uint32_t count;
+    uint32_t min;
+    uint32_t max;
+    uint64_t sum;
+} perf_stat_t;
+
+void perf_init(void);
+uint32_t perf_cycles(void);
+uint32_t perf_cycles_since(uint32_t start);
+void perf_record(perf_stat_id_t id, uint32_t value);
+void perf_count(perf_counter_id_t id);
+void perf_report(void);
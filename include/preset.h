@@ -0,0 +1,35 @@
+/*
+ * Copyright 2025, Hiroyuki OYAMA
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "fx.h"
+
+#define PRESET_COMMAND_VERSION 1
+#define PRESET_FLAG_SAVE 0x01  // persist the parameters as well as applying them
+#define PRESET_REQUEST_GET 0x01  // vendor control IN request, answered with the current command
+
+// Little-endian command received on the vendor OUT endpoint; see tools/fx_preset.py. The
+// PRESET_REQUEST_GET control request to the vendor interface returns one holding the current
+// parameters, so the host can change some of them and send back the rest unchanged.
+typedef struct __attribute__((packed)) {
+    uint8_t version;
+    uint8_t flags;
+    uint16_t reserved;
+    fx_params_t params;
+} preset_command_t;
+
+// Scan the flash log; cheap enough to run before USB starts.
+void preset_init(void);
+// Latest saved parameters for the linked effect.
+bool preset_load(fx_params_t *params);
+// Queue parameters to be written; the write happens in preset_task().
+void preset_save(const fx_params_t *params);
+// Flash erase and program stall execution from flash, USB and audio included, so a queued
+// save is only written while `audio_idle` says no audio is flowing.
+void preset_task(bool audio_idle);
@@ -12,9 +12,14 @@
 #define RINGBUF_FRAMES 16
 #define TOTAL_SAMPLES (RINGBUF_FRAMES * AUDIO_FRAME_SAMPLES)
 
+// A single ring shared by both endpoints. Frames are filled by the OUT endpoint at write_idx,
+// processed in place at process_idx and sent on the IN endpoint from read_idx, so a bypassed
+// frame goes out of the very slot it arrived in.
 typedef struct {
     uint8_t buffer[RINGBUF_FRAMES][AUDIO_FRAME_BYTES];
+    uint32_t arrival_us[RINGBUF_FRAMES];    // time_us_32() at which the OUT frame was received
     volatile uint8_t read_idx;
+    volatile uint8_t process_idx;
     volatile uint8_t write_idx;
 } ringbuf_t;
 
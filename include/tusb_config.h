@@ -21,7 +21,7 @@ extern "C" {
 #define CFG_TUD_HID    0
 #define CFG_TUD_MIDI   0
 #define CFG_TUD_AUDIO  1
-#define CFG_TUD_VENDOR 0
+#define CFG_TUD_VENDOR 1
 
 #define CFG_TUD_AUDIO_ENABLE_INTERRUPT_EP                    1
 #define CFG_TUD_AUDIO_FUNC_1_DESC_LEN                        TUD_AUDIO_INTERFACE_STEREO_DESC_LEN
@@ -54,6 +54,11 @@ extern "C" {
 
 #define CFG_TUD_AUDIO_FUNC_1_CTRL_BUF_SZ          64
 
+// Vendor interface carrying meter reports to the host
+#define CFG_TUD_VENDOR_EPSIZE                     64
+#define CFG_TUD_VENDOR_RX_BUFSIZE                 64
+#define CFG_TUD_VENDOR_TX_BUFSIZE                 64
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,106 @@
+/*
+ * Copyright 2025, Hiroyuki OYAMA
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+#include "clock_governor.h"
+
+#include <stdbool.h>
+
+#include "hardware/clocks.h"
+#include "pico/stdlib.h"
+
+#define GOVERNOR_WINDOW_FRAMES 500       // frames of low load required before stepping down
+#define GOVERNOR_TARGET_LOAD_PCT 50      // load aimed for after any switch
+#define GOVERNOR_UP_LOAD_PCT 75          // a single frame above this steps up at once
+#define GOVERNOR_WORST_CASE_LOAD_PCT 90  // a reserved worst case must always fit in this
+
+// One frame is 1 ms, so the cycle budget per frame equals the clock in kHz.
+static const uint32_t clock_levels_khz[] = {48000, 96000, 125000, 150000, 200000, 240000};
+#define NUM_CLOCK_LEVELS (sizeof(clock_levels_khz) / sizeof(clock_levels_khz[0]))
+
+static int min_level = 0;
+static bool reserved = false;
+static uint32_t reserved_peak = 0;  // highest frame measured while a reservation was held
+static int current_level = NUM_CLOCK_LEVELS - 1;
+static int target_level = NUM_CLOCK_LEVELS - 1;
+static uint32_t window_peak = 0;
+static uint32_t window_frames = 0;
+
+static bool fits(uint32_t cycles, int level, uint32_t load_pct) {
+    return (uint64_t)cycles * 100 <= (uint64_t)clock_levels_khz[level] * load_pct;
+}
+
+static int level_for(uint32_t cycles, uint32_t load_pct) {
+    for (int i = min_level; i < (int)NUM_CLOCK_LEVELS; i++) {
+        if (fits(cycles, i, load_pct))
+            return i;
+    }
+    return NUM_CLOCK_LEVELS - 1;
+}
+
+static void window_reset(void) {
+    window_peak = 0;
+    window_frames = 0;
+}
+
+void clock_governor_init(void) {
+    min_level = 0;
+    reserved = false;
+
+    // Start at full speed so enumeration and the first frames are not starved.
+    current_level = target_level = NUM_CLOCK_LEVELS - 1;
+    set_sys_clock_khz(clock_levels_khz[current_level], true);
+    window_reset();
+}
+
+// While reserved, never drop below the clock at which the worst case still fits, so an abrupt
+// change of effect state cannot overrun a frame before the governor reacts. The worst case is
+// the declared figure or the highest frame measured under a reservation, whichever is larger.
+// Raising the floor takes effect at the next clock_governor_update().
+void clock_governor_reserve(uint32_t cycles) {
+    reserved = cycles != 0;
+    min_level = 0;
+    if (!reserved)
+        return;
+    if (reserved_peak > cycles)
+        cycles = reserved_peak;
+    min_level = level_for(cycles, GOVERNOR_WORST_CASE_LOAD_PCT);
+    if (target_level < min_level)
+        target_level = min_level;
+}
+
+void clock_governor_record(uint32_t dsp_cycles) {
+    if (reserved && dsp_cycles > reserved_peak)
+        reserved_peak = dsp_cycles;
+    if (dsp_cycles > window_peak)
+        window_peak = dsp_cycles;
+    window_frames++;
+
+    if (!fits(dsp_cycles, current_level, GOVERNOR_UP_LOAD_PCT)) {
+        int level = level_for(dsp_cycles, GOVERNOR_TARGET_LOAD_PCT);
+        if (level > target_level)
+            target_level = level;
+    } else if (window_frames >= GOVERNOR_WINDOW_FRAMES) {
+        int level = level_for(window_peak, GOVERNOR_TARGET_LOAD_PCT);
+        if (level < current_level)
+            target_level = level;
+        window_reset();
+    }
+}
+
+// Call from the main loop, never from a USB callback: the PLL relock briefly runs the core from
+// clk_ref and must not land inside a frame. USB and the timer are clocked independently of
+// clk_sys and keep running meanwhile.
+void clock_governor_update(void) {
+    if (target_level == current_level)
+        return;
+
+    if (set_sys_clock_khz(clock_levels_khz[target_level], false))
+        current_level = target_level;
+    else
+        target_level = current_level;
+    window_reset();
+}
+
+uint32_t clock_governor_khz(void) { return clock_levels_khz[current_level]; }
@@ -0,0 +1,362 @@
+/*
+ * Copyright 2025, Hiroyuki OYAMA
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+#include "dsp.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "perf.h"
+#include "ringbuffer.h"
+
+#if DSP_VARIANT_M33
+#include <arm_acle.h>
+#endif
+
+#define SELFTEST_FRAMES 8
+#define SELFTEST_RING_FRAMES (4 * AUDIO_FRAME_SAMPLES)
+
+void dsp_biquad_lowpass(dsp_biquad_t *bq, float fs, float fc, float q) {
+    float omega = 2.0f * M_PI * (fc / fs);
+    float sin_omega = sinf(omega);
+    float cos_omega = cosf(omega);
+    float alpha = sin_omega / (2.0f * q);
+
+    float a0_inv = 1.0f / (1.0f + alpha);
+    bq->b0 = ((1.0f - cos_omega) / 2.0f) * a0_inv;
+    bq->b1 = (1.0f - cos_omega) * a0_inv;
+    bq->b2 = bq->b0;
+    bq->a1 = -2.0f * cos_omega * a0_inv;
+    bq->a2 = (1.0f - alpha) * a0_inv;
+    bq->c1 = bq->b1 - bq->a1;
+    bq->c2 = bq->b2 - bq->a2;
+}
+
+void dsp_biquad_reset(dsp_biquad_t *bq) {
+    bq->z1 = 0.0f;
+    bq->z2 = 0.0f;
+}
+
+/*
+ * Portable reference implementations
+ */
+
+void dsp_ref_biquad_cascade(int32_t *buf, size_t frames, size_t stride, dsp_biquad_t *stages,
+                            size_t n_stages, dsp_level_t *level) {
+    for (size_t s = 0; s < n_stages; s++) {
+        dsp_biquad_t *bq = &stages[s];
+        dsp_level_t *out_level = (s + 1 == n_stages) ? level : NULL;
+        int32_t *p = buf;
+        for (size_t i = 0; i < frames; i++, p += stride) {
+            float x = (float)(p[0]) / (1 << 8);  // 24bitスロット →  float変換
+            float y = bq->b0 * x + bq->b1 * bq->z1 + bq->b2 * bq->z2 - bq->a1 * bq->z1 -
+                      bq->a2 * bq->z2;
+            bq->z2 = bq->z1;
+            bq->z1 = y;
+            p[0] = (int32_t)(y * (1 << 8));  // float →  24bitスロット
+            if (out_level)
+                dsp_level_add(out_level, p[0]);
+        }
+    }
+}
+
+float dsp_ref_resample(int32_t *out, const int32_t *ring, size_t ring_frames, float pos,
+                       float speed, size_t frames) {
+    for (size_t i = 0; i < frames; i++) {
+        int pos_int = ((int)pos) % (int)ring_frames;
+        int next_pos = (pos_int + 1) % (int)ring_frames;
+        float frac = pos - floorf(pos);
+
+        for (int ch = 0; ch < AUDIO_NUM_CHANNELS; ch++) {
+            int32_t s1 = ring[pos_int * AUDIO_NUM_CHANNELS + ch];
+            int32_t s2 = ring[next_pos * AUDIO_NUM_CHANNELS + ch];
+            *out++ = (frac < 1e-4f) ? s1 : (int32_t)(s1 * (1.0f - frac) + s2 * frac);
+        }
+
+        if (speed > 0.0f) {
+            pos += speed;
+            if (pos >= ring_frames)
+                pos -= ring_frames;
+        }
+    }
+    return pos;
+}
+
+static int32_t clamp_gain(int32_t gain) {
+    if (gain < 0)
+        return 0;
+    if (gain > DSP_GAIN_UNITY)
+        return DSP_GAIN_UNITY;
+    return gain;
+}
+
+int32_t dsp_ref_crossfade(int32_t *out, const int32_t *from, const int32_t *to, size_t frames,
+                          int32_t gain, int32_t step, dsp_level_t *levels) {
+    for (size_t i = 0; i < frames; i++) {
+        for (int ch = 0; ch < AUDIO_NUM_CHANNELS; ch++) {
+            size_t n = i * AUDIO_NUM_CHANNELS + ch;
+            out[n] = (int32_t)(((int64_t)from[n] * (DSP_GAIN_UNITY - gain) +
+                                (int64_t)to[n] * gain) >> 15);
+            if (levels)
+                dsp_level_add(&levels[ch], out[n]);
+        }
+        gain = clamp_gain(gain + step);
+    }
+    return gain;
+}
+
+#if DSP_VARIANT_M33
+
+/*
+ * Cortex-M33 kernels: single-precision FPU with fused multiply-add and the DSP extension.
+ */
+
+// Both stages of a pair run in one pass with their state in registers, and the signal stays
+// in float between them instead of round-tripping through the 24-bit slot.
+static void biquad_pair_m33(int32_t *buf, size_t frames, size_t stride, dsp_biquad_t *s0,
+                            dsp_biquad_t *s1, dsp_level_t *level) {
+    const float b0a = s0->b0, c1a = s0->c1, c2a = s0->c2;
+    const float b0b = s1->b0, c1b = s1->c1, c2b = s1->c2;
+    float z1a = s0->z1, z2a = s0->z2;
+    float z1b = s1->z1, z2b = s1->z2;
+
+    for (size_t i = 0; i < frames; i++, buf += stride) {
+        float x = (float)buf[0] * (1.0f / (1 << 8));
+        float ya = fmaf(c2a, z2a, fmaf(c1a, z1a, b0a * x));
+        z2a = z1a;
+        z1a = ya;
+        float yb = fmaf(c2b, z2b, fmaf(c1b, z1b, b0b * ya));
+        z2b = z1b;
+        z1b = yb;
+        buf[0] = (int32_t)(yb * (1 << 8));
+        if (level)
+            dsp_level_add(level, buf[0]);
+    }
+
+    s0->z1 = z1a;
+    s0->z2 = z2a;
+    s1->z1 = z1b;
+    s1->z2 = z2b;
+}
+
+static void biquad_single_m33(int32_t *buf, size_t frames, size_t stride, dsp_biquad_t *bq,
+                              dsp_level_t *level) {
+    const float b0 = bq->b0, c1 = bq->c1, c2 = bq->c2;
+    float z1 = bq->z1, z2 = bq->z2;
+
+    for (size_t i = 0; i < frames; i++, buf += stride) {
+        float y = fmaf(c2, z2, fmaf(c1, z1, b0 * ((float)buf[0] * (1.0f / (1 << 8)))));
+        z2 = z1;
+        z1 = y;
+        buf[0] = (int32_t)(y * (1 << 8));
+        if (level)
+            dsp_level_add(level, buf[0]);
+    }
+
+    bq->z1 = z1;
+    bq->z2 = z2;
+}
+
+void dsp_biquad_cascade(int32_t *buf, size_t frames, size_t stride, dsp_biquad_t *stages,
+                        size_t n_stages, dsp_level_t *level) {
+    size_t s = 0;
+    for (; s + 1 < n_stages; s += 2) {
+        biquad_pair_m33(buf, frames, stride, &stages[s], &stages[s + 1],
+                        (s + 2 == n_stages) ? level : NULL);
+    }
+    if (s < n_stages)
+        biquad_single_m33(buf, frames, stride, &stages[s], level);
+}
+
+// The position is never negative, so truncation replaces floorf() and the modulo becomes a
+// compare; the blend is a single fused multiply-add per sample.
+float dsp_resample(int32_t *out, const int32_t *ring, size_t ring_frames, float pos, float speed,
+                   size_t frames) {
+    const float advance = (speed > 0.0f) ? speed : 0.0f;
+    const float wrap = (float)ring_frames;
+
+    for (size_t i = 0; i < frames; i++) {
+        uint32_t pos_int = (uint32_t)pos;
+        if (pos_int >= ring_frames)
+            pos_int -= ring_frames;
+        uint32_t next_pos = (pos_int + 1 == ring_frames) ? 0 : pos_int + 1;
+        float frac = pos - (float)(uint32_t)pos;
+
+        const int32_t *p1 = &ring[pos_int * AUDIO_NUM_CHANNELS];
+        const int32_t *p2 = &ring[next_pos * AUDIO_NUM_CHANNELS];
+        if (frac < 1e-4f) {
+            out[0] = p1[0];
+            out[1] = p1[1];
+        } else {
+            float l = (float)p1[0], r = (float)p1[1];
+            out[0] = (int32_t)fmaf((float)p2[0] - l, frac, l);
+            out[1] = (int32_t)fmaf((float)p2[1] - r, frac, r);
+        }
+        out += AUDIO_NUM_CHANNELS;
+
+        pos += advance;
+        if (pos >= wrap)
+            pos -= wrap;
+    }
+    return pos;
+}
+
+// SMULWB gives the top 32 bits of a 32x16 product in one cycle. Both gains are kept inside
+// the signed 16-bit range by handling the end points as plain copies, and QADD saturates the
+// sum and the final doubling back to Q15.
+int32_t dsp_crossfade(int32_t *out, const int32_t *from, const int32_t *to, size_t frames,
+                      int32_t gain, int32_t step, dsp_level_t *levels) {
+    for (size_t i = 0; i < frames; i++) {
+        size_t n = i * AUDIO_NUM_CHANNELS;
+        if (gain <= 0) {
+            out[n] = from[n];
+            out[n + 1] = from[n + 1];
+        } else if (gain >= DSP_GAIN_UNITY) {
+            out[n] = to[n];
+            out[n + 1] = to[n + 1];
+        } else {
+            int32_t g_from = DSP_GAIN_UNITY - gain;
+            int32_t l = __qadd(__smulwb(from[n], g_from), __smulwb(to[n], gain));
+            int32_t r = __qadd(__smulwb(from[n + 1], g_from), __smulwb(to[n + 1], gain));
+            out[n] = __qadd(l, l);
+            out[n + 1] = __qadd(r, r);
+        }
+        if (levels) {
+            dsp_level_add(&levels[0], out[n]);
+            dsp_level_add(&levels[1], out[n + 1]);
+        }
+        gain = clamp_gain(gain + step);
+    }
+    return gain;
+}
+
+const char *dsp_variant(void) { return "m33"; }
+
+#else
+
+void dsp_biquad_cascade(int32_t *buf, size_t frames, size_t stride, dsp_biquad_t *stages,
+                        size_t n_stages, dsp_level_t *level) {
+    dsp_ref_biquad_cascade(buf, frames, stride, stages, n_stages, level);
+}
+
+float dsp_resample(int32_t *out, const int32_t *ring, size_t ring_frames, float pos, float speed,
+                   size_t frames) {
+    return dsp_ref_resample(out, ring, ring_frames, pos, speed, frames);
+}
+
+int32_t dsp_crossfade(int32_t *out, const int32_t *from, const int32_t *to, size_t frames,
+                      int32_t gain, int32_t step, dsp_level_t *levels) {
+    return dsp_ref_crossfade(out, from, to, frames, gain, step, levels);
+}
+
+const char *dsp_variant(void) { return "generic"; }
+
+#endif
+
+/*
+ * Self test: run the selected variant against the reference on the same input and publish
+ * cycles per frame for both.
+ */
+
+static int32_t ref_buf[AUDIO_FRAME_SAMPLES * AUDIO_NUM_CHANNELS];
+static int32_t dut_buf[AUDIO_FRAME_SAMPLES * AUDIO_NUM_CHANNELS];
+static int32_t test_ring[SELFTEST_RING_FRAMES * AUDIO_NUM_CHANNELS];
+
+static void fill_noise(int32_t *buf, size_t n, uint32_t *seed) {
+    for (size_t i = 0; i < n; i++) {
+        *seed = *seed * 1664525u + 1013904223u;
+        buf[i] = ((int32_t)*seed >> 2) & ~0xff;  // -12 dBFS, 24-bit in a 32-bit slot
+    }
+}
+
+static uint32_t max_error_lsb(const int32_t *a, const int32_t *b, size_t n) {
+    uint32_t max = 0;
+    for (size_t i = 0; i < n; i++) {
+        int64_t diff = ((int64_t)a[i] - b[i]) >> 8;
+        uint32_t err = (uint32_t)(diff < 0 ? -diff : diff);
+        if (err > max)
+            max = err;
+    }
+    return max;
+}
+
+static bool report(const char *kernel, uint32_t ref_cycles, uint32_t dut_cycles, uint32_t err,
+                   uint32_t tolerance) {
+    printf("dsp %s: ref=%lu %s=%lu cycles/frame, max error %lu LSB (%s)\n", kernel,
+           (unsigned long)(ref_cycles / SELFTEST_FRAMES), dsp_variant(),
+           (unsigned long)(dut_cycles / SELFTEST_FRAMES), (unsigned long)err,
+           err <= tolerance ? "ok" : "FAIL");
+    return err <= tolerance;
+}
+
+bool dsp_selftest(void) {
+    const size_t n = AUDIO_FRAME_SAMPLES * AUDIO_NUM_CHANNELS;
+    uint32_t seed = 1;
+    uint32_t ref_cycles = 0, dut_cycles = 0, err = 0, start;
+    bool ok = true;
+
+    // LPF: two stages per channel, as fx_lpf.c runs them
+    dsp_biquad_t ref_bq[2], dut_bq[2];
+    for (int s = 0; s < 2; s++) {
+        dsp_biquad_lowpass(&ref_bq[s], 48000.0f, 2000.0f, 6.0f);
+        dsp_biquad_reset(&ref_bq[s]);
+    }
+    memcpy(dut_bq, ref_bq, sizeof(dut_bq));
+    for (int f = 0; f < SELFTEST_FRAMES; f++) {
+        fill_noise(ref_buf, n, &seed);
+        memcpy(dut_buf, ref_buf, sizeof(dut_buf));
+        start = perf_cycles();
+        dsp_ref_biquad_cascade(ref_buf, AUDIO_FRAME_SAMPLES, AUDIO_NUM_CHANNELS, ref_bq, 2, NULL);
+        ref_cycles += perf_cycles_since(start);
+        start = perf_cycles();
+        dsp_biquad_cascade(dut_buf, AUDIO_FRAME_SAMPLES, AUDIO_NUM_CHANNELS, dut_bq, 2, NULL);
+        dut_cycles += perf_cycles_since(start);
+        uint32_t e = max_error_lsb(ref_buf, dut_buf, n);
+        if (e > err)
+            err = e;
+    }
+    ok &= report("biquad x2", ref_cycles, dut_cycles, err, DSP_BIQUAD_TOLERANCE_LSB);
+
+    // TapeStop interpolator at a slowed-down speed
+    fill_noise(test_ring, SELFTEST_RING_FRAMES * AUDIO_NUM_CHANNELS, &seed);
+    float ref_pos = 17.25f, dut_pos = 17.25f;
+    ref_cycles = dut_cycles = err = 0;
+    for (int f = 0; f < SELFTEST_FRAMES; f++) {
+        start = perf_cycles();
+        ref_pos = dsp_ref_resample(ref_buf, test_ring, SELFTEST_RING_FRAMES, ref_pos, 0.37f,
+                                   AUDIO_FRAME_SAMPLES);
+        ref_cycles += perf_cycles_since(start);
+        start = perf_cycles();
+        dut_pos = dsp_resample(dut_buf, test_ring, SELFTEST_RING_FRAMES, dut_pos, 0.37f,
+                               AUDIO_FRAME_SAMPLES);
+        dut_cycles += perf_cycles_since(start);
+        uint32_t e = max_error_lsb(ref_buf, dut_buf, n);
+        if (e > err)
+            err = e;
+    }
+    ok &= report("resample", ref_cycles, dut_cycles, err, DSP_RESAMPLE_TOLERANCE_LSB);
+
+    // Crossfade ramp across the full gain range
+    const int32_t *from = &test_ring[0];
+    const int32_t *to = &test_ring[n];
+    int32_t ref_gain = 0, dut_gain = 0;
+    const int32_t step = DSP_GAIN_UNITY / (SELFTEST_FRAMES * AUDIO_FRAME_SAMPLES);
+    ref_cycles = dut_cycles = err = 0;
+    for (int f = 0; f < SELFTEST_FRAMES; f++) {
+        start = perf_cycles();
+        ref_gain =
+            dsp_ref_crossfade(ref_buf, from, to, AUDIO_FRAME_SAMPLES, ref_gain, step, NULL);
+        ref_cycles += perf_cycles_since(start);
+        start = perf_cycles();
+        dut_gain = dsp_crossfade(dut_buf, from, to, AUDIO_FRAME_SAMPLES, dut_gain, step, NULL);
+        dut_cycles += perf_cycles_since(start);
+        uint32_t e = max_error_lsb(ref_buf, dut_buf, n);
+        if (e > err)
+            err = e;
+    }
+    ok &= report("crossfade", ref_cycles, dut_cycles, err, DSP_CROSSFADE_TOLERANCE_LSB);
+    return ok;
+}
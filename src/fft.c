@@ -0,0 +1,125 @@
+/*
+ * Copyright 2025, Hiroyuki OYAMA
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+#include "fft.h"
+
+#include <math.h>
+
+// Keeping every complex magnitude below 2^16 bounds the twiddle products below 2^31, so the
+// butterflies never need 64-bit arithmetic (slow on the Cortex-M0+). A stage may double the
+// magnitude, so it runs unscaled only when every component is below 2^13; scaled stages never
+// grow it. The peak is tracked as an OR of magnitudes, which preserves the highest set bit and
+// costs no compares.
+#define FFT_SCALE_THRESHOLD (1 << 13)
+
+static int16_t cos_table[FFT_SIZE];
+static int16_t sin_table[FFT_SIZE];
+static int16_t window_table[FFT_SIZE];
+static uint8_t bitrev_table[FFT_SIZE];
+
+static int16_t to_q15(float x) {
+    float v = roundf(x * 32768.0f);
+    if (v > 32767.0f)
+        v = 32767.0f;
+    if (v < -32768.0f)
+        v = -32768.0f;
+    return (int16_t)v;
+}
+
+void fft_init(void) {
+    for (int i = 0; i < FFT_SIZE; i++) {
+        float phase = 2.0f * (float)M_PI * i / FFT_SIZE;
+        cos_table[i] = to_q15(cosf(phase));
+        sin_table[i] = to_q15(sinf(phase));
+        window_table[i] = to_q15(0.5f - 0.5f * cosf(phase));
+
+        uint32_t r = 0;
+        for (int b = 0; b < FFT_LOG2_SIZE; b++)
+            r |= ((i >> b) & 1) << (FFT_LOG2_SIZE - 1 - b);
+        bitrev_table[i] = (uint8_t)r;
+    }
+}
+
+void fft_phasor(uint32_t index, int32_t *cos_q15, int32_t *sin_q15) {
+    index &= FFT_SIZE - 1;
+    *cos_q15 = cos_table[index];
+    *sin_q15 = sin_table[index];
+}
+
+int32_t fft_window(uint32_t n) { return window_table[n & (FFT_SIZE - 1)]; }
+
+static int32_t abs32(int32_t x) { return x < 0 ? -x : x; }
+
+static inline int32_t mul_q15(int32_t x, int32_t w) { return (x * w + (1 << 14)) >> 15; }
+
+static void bit_reverse(fft_t *fft) {
+    fft_complex_t *x = fft->data;
+    int32_t peak = 0;
+    for (int i = 0; i < FFT_SIZE; i++) {
+        int j = bitrev_table[i];
+        if (j > i) {
+            fft_complex_t t = x[i];
+            x[i] = x[j];
+            x[j] = t;
+        }
+        peak |= abs32(x[i].re) | abs32(x[i].im);
+    }
+    fft->peak = peak;
+}
+
+static void butterfly_stage(fft_t *fft, int stage) {
+    fft_complex_t *x = fft->data;
+    const int half = 1 << stage;
+    const int span = half << 1;
+    const int twiddle_step = FFT_SIZE / span;
+    const int shift = (fft->peak >= FFT_SCALE_THRESHOLD) ? 1 : 0;
+    int32_t peak = 0;
+
+    for (int j = 0; j < half; j++) {
+        int32_t w_re = cos_table[j * twiddle_step];
+        int32_t w_im = sin_table[j * twiddle_step];
+        if (!fft->inverse)
+            w_im = -w_im;
+
+        for (int i = j; i < FFT_SIZE; i += span) {
+            fft_complex_t *a = &x[i];
+            fft_complex_t *b = &x[i + half];
+            int32_t t_re = mul_q15(b->re, w_re) - mul_q15(b->im, w_im);
+            int32_t t_im = mul_q15(b->re, w_im) + mul_q15(b->im, w_re);
+            int32_t a_re = a->re, a_im = a->im;
+
+            a->re = (a_re + t_re) >> shift;
+            a->im = (a_im + t_im) >> shift;
+            b->re = (a_re - t_re) >> shift;
+            b->im = (a_im - t_im) >> shift;
+
+            peak |= abs32(a->re) | abs32(a->im) | abs32(b->re) | abs32(b->im);
+        }
+    }
+    fft->peak = peak;
+    fft->exponent += shift;
+}
+
+void fft_begin(fft_t *fft, fft_complex_t *data, bool inverse) {
+    fft->data = data;
+    fft->step = 0;
+    fft->exponent = 0;
+    fft->peak = 0;
+    fft->inverse = inverse;
+}
+
+bool fft_step(fft_t *fft) {
+    if (fft->step == 0)
+        bit_reverse(fft);
+    else if (fft->step <= FFT_LOG2_SIZE)
+        butterfly_stage(fft, fft->step - 1);
+    fft->step++;
+    return fft->step >= FFT_STEPS;
+}
+
+void fft_run(fft_t *fft) {
+    while (!fft_step(fft))
+        ;
+}
@@ -0,0 +1,327 @@
+#include <string.h>
+#include "dsp.h"
+#include "fft.h"
+#include "fx.h"
+#include "meter.h"
+#include "ringbuffer.h"
+
+// Spectral freeze: on press, capture FFT_SIZE samples, keep their magnitude spectrum and
+// resynthesise it with fresh random phases every hop. All FFT work is cut into units of about
+// one radix-2 stage and a fixed number of units runs per frame, so the worst frame costs the
+// same as the average one.
+#define FREEZE_HOP        (FFT_SIZE / 4)      // 75 % overlap
+#define FREEZE_BINS       (FFT_SIZE / 2 + 1)
+#define FREEZE_OLA_SIZE   (FFT_SIZE * 2)      // power of two, holds a frame and a full hop ahead
+#define FREEZE_LEAD       (FREEZE_HOP * 3)    // synthesis runs this far ahead of the output
+#define FREEZE_MAG_BINS   32                  // magnitude bins per unit
+#define FREEZE_MAG_UNITS  ((FREEZE_BINS + FREEZE_MAG_BINS - 1) / FREEZE_MAG_BINS)
+#define FREEZE_UNITS      9                   // per frame; a hop takes FFT_STEPS + 2 units
+#define FREEZE_GAIN_Q14   21845               // 4/3: Hann analysis and Hann overlap-add at 75 %
+#define FREEZE_XFADE_STEP (DSP_GAIN_UNITY / (4 * AUDIO_FRAME_SAMPLES))
+#define FREEZE_OLA_LIMIT  (1 << 25)           // per-hop clamp, so four overlaps fit in int32
+
+typedef enum {
+    FREEZE_IDLE,
+    FREEZE_CAPTURE,  // collecting the window to freeze; output is dry
+    FREEZE_ANALYZE,  // windowed forward FFT and magnitudes, spread over a few frames
+    FREEZE_FROZEN,   // one inverse FFT and overlap-add per hop
+} freeze_state_t;
+
+static freeze_state_t state   = FREEZE_IDLE;
+static bool           enabled = false;
+
+static int16_t  history[FFT_SIZE][AUDIO_NUM_CHANNELS];  // top 16 bits of the captured input
+static uint32_t captured = 0;
+static int      input_shift;
+
+static fft_complex_t work[FFT_SIZE];
+static fft_t         fft;
+static int           job_step   = 0;
+static bool          job_active = false;
+
+static uint16_t magnitude[AUDIO_NUM_CHANNELS][FREEZE_BINS];
+static int      spectrum_exponent;  // |DFT of windowed 16-bit input| = magnitude * 2^exponent
+
+static int32_t  ola[FREEZE_OLA_SIZE][AUDIO_NUM_CHANNELS];  // 24-bit scale
+static int32_t  wet_buf[AUDIO_FRAME_SAMPLES * AUDIO_NUM_CHANNELS];
+static uint32_t emit_pos  = 0;  // sample position of the next output frame
+static uint32_t hop_pos   = 0;  // sample position of the next hop to synthesise
+static uint32_t wet_start = 0;
+static uint32_t hops      = 0;
+static int32_t  xfade_gain = 0;
+static uint32_t rng = 1;
+
+const char* fx_name(void) {
+    return "Pico Audio FX Freeze";
+}
+
+void fx_init(void) {
+    fft_init();
+}
+
+// Estimate: nine units of at most one FFT stage, 32 square roots or a 256-sample overlap-add,
+// plus the output crossfade.
+uint32_t fx_cycles_per_frame(void) {
+    return 60000;
+}
+
+// Dry until the frozen spectrum takes over, and that is not a delayed copy of the input.
+uint32_t fx_latency_samples(void) {
+    return 0;
+}
+
+// No tunable parameters yet.
+void fx_get_params(fx_params_t *params) {
+    memset(params, 0, sizeof(*params));
+}
+
+void fx_set_params(const fx_params_t *params) {
+    (void)params;
+}
+
+void fx_set_enable(bool enable) {
+    if (enable && !enabled) {
+        state      = FREEZE_CAPTURE;
+        captured   = 0;
+        job_active = false;
+    }
+    enabled = enable;
+}
+
+// Once released the frozen sound keeps playing while the pipeline fades it out.
+bool fx_is_idle(void) {
+    return !enabled;
+}
+
+// Capture needs every frame and the frozen spectrum plays regardless of input.
+bool fx_has_tail(void) {
+    return true;
+}
+
+uint32_t fx_status(void) {
+    return hops;
+}
+
+static uint32_t isqrt32(uint32_t x) {
+    uint32_t r = 0;
+    uint32_t bit = 1u << 30;
+    while (bit > x)
+        bit >>= 2;
+    while (bit) {
+        if (x >= r + bit) {
+            x -= r + bit;
+            r = (r >> 1) + bit;
+        } else {
+            r >>= 1;
+        }
+        bit >>= 2;
+    }
+    return r;
+}
+
+static int32_t clamp32(int32_t x, int32_t limit) {
+    if (x > limit)
+        return limit;
+    if (x < -limit)
+        return -limit;
+    return x;
+}
+
+// Window both channels into one complex transform, z = l + j r. Quiet input is shifted up until
+// its peak reaches 2^13; loud input is used as is. Every component stays below 2^15 either way,
+// inside the FFT's 2^16 magnitude bound.
+static void analysis_load(void) {
+    int32_t peak = 0;
+    for (int n = 0; n < FFT_SIZE; n++) {
+        int32_t l = history[n][0], r = history[n][1];
+        peak |= (l < 0 ? -l : l) | (r < 0 ? -r : r);
+    }
+    input_shift = 0;
+    while (peak != 0 && (peak << input_shift) < (1 << 13))
+        input_shift++;
+
+    uint32_t oldest = captured;
+    for (int n = 0; n < FFT_SIZE; n++) {
+        uint32_t i = (oldest + n) & (FFT_SIZE - 1);
+        int32_t w = fft_window(n);
+        work[n].re = ((history[i][0] << input_shift) * w) >> 15;
+        work[n].im = ((history[i][1] << input_shift) * w) >> 15;
+    }
+    fft_begin(&fft, work, false);
+}
+
+// |L|, |R| < 2^16, so the squared magnitude fits in uint32 but not int32.
+static uint32_t magnitude_sq(int32_t re, int32_t im) {
+    uint32_t a = (uint32_t)(re < 0 ? -re : re);
+    uint32_t b = (uint32_t)(im < 0 ? -im : im);
+    return a * a + b * b;
+}
+
+// Split the packed spectrum: L[k] = (Z[k] + Z*[N-k]) / 2, R[k] = (Z[k] - Z*[N-k]) / 2j.
+static void analysis_magnitude(int first) {
+    int last = first + FREEZE_MAG_BINS;
+    if (last > FREEZE_BINS)
+        last = FREEZE_BINS;
+    for (int k = first; k < last; k++) {
+        fft_complex_t z = work[k];
+        fft_complex_t zn = work[(FFT_SIZE - k) & (FFT_SIZE - 1)];
+        int32_t l_re = (z.re + zn.re) >> 1, l_im = (z.im - zn.im) >> 1;
+        int32_t r_re = (z.im + zn.im) >> 1, r_im = (zn.re - z.re) >> 1;
+        magnitude[0][k] = (uint16_t)isqrt32(magnitude_sq(l_re, l_im));
+        magnitude[1][k] = (uint16_t)isqrt32(magnitude_sq(r_re, r_im));
+    }
+    spectrum_exponent = fft.exponent - input_shift;
+}
+
+static uint32_t random_phase(void) {
+    rng = rng * 1664525u + 1013904223u;
+    return rng >> (32 - FFT_LOG2_SIZE);
+}
+
+// Pack both channels' randomised spectra, halved, into one Hermitian-paired transform:
+// Y[k] = L'[k] + j R'[k], Y[N-k] = L'*[k] + j R'*[k].
+static void synthesis_build(void) {
+    work[0].re = work[0].im = 0;
+    work[FFT_SIZE / 2].re = work[FFT_SIZE / 2].im = 0;
+    for (int k = 1; k < FFT_SIZE / 2; k++) {
+        int32_t c, s;
+        fft_phasor(random_phase(), &c, &s);
+        int32_t l_re = ((int32_t)magnitude[0][k] * c) >> 16;
+        int32_t l_im = ((int32_t)magnitude[0][k] * s) >> 16;
+        fft_phasor(random_phase(), &c, &s);
+        int32_t r_re = ((int32_t)magnitude[1][k] * c) >> 16;
+        int32_t r_im = ((int32_t)magnitude[1][k] * s) >> 16;
+
+        work[k].re = l_re - r_im;
+        work[k].im = l_im + r_re;
+        work[FFT_SIZE - k].re = l_re + r_im;
+        work[FFT_SIZE - k].im = r_re - l_im;
+    }
+    fft_begin(&fft, work, true);
+}
+
+// Window the inverse transform (left in the real part, right in the imaginary part) and add it
+// into the output ring at 24-bit scale.
+static void synthesis_overlap_add(void) {
+    // y = work * 2^(spectrum_exponent + 1 + exponent - log2 N) in 16-bit units
+    int shift = spectrum_exponent + 1 + fft.exponent - FFT_LOG2_SIZE + 8;
+    int32_t limit = FREEZE_OLA_LIMIT;
+    if (shift > 0)
+        limit >>= shift;
+
+    for (int n = 0; n < FFT_SIZE; n++) {
+        int32_t w = fft_window(n);
+        int32_t *slot = ola[(hop_pos + n) & (FREEZE_OLA_SIZE - 1)];
+        for (int ch = 0; ch < AUDIO_NUM_CHANNELS; ch++) {
+            int32_t v = ch ? work[n].im : work[n].re;
+            v = (v * w) >> 15;
+            v = (v * FREEZE_GAIN_Q14) >> 14;
+            v = clamp32(v, limit);
+            slot[ch] += (shift >= 0) ? (v << shift) : (v >> -shift);
+        }
+    }
+    hop_pos += FREEZE_HOP;
+    hops++;
+}
+
+static void start_frozen(void) {
+    state      = FREEZE_FROZEN;
+    hop_pos    = emit_pos + FREEZE_LEAD;
+    wet_start  = hop_pos + FFT_SIZE - FREEZE_HOP;  // first sample every overlapping hop covers
+    xfade_gain = 0;
+    job_active = false;
+    memset(ola, 0, sizeof(ola));
+}
+
+// Run one unit of pending work; false when there is nothing to do this frame.
+static bool run_unit(void) {
+    if (state == FREEZE_ANALYZE) {
+        if (job_step == 0)
+            analysis_load();
+        else if (job_step <= FFT_STEPS)
+            fft_step(&fft);
+        else
+            analysis_magnitude((job_step - FFT_STEPS - 1) * FREEZE_MAG_BINS);
+
+        if (++job_step > FFT_STEPS + FREEZE_MAG_UNITS)
+            start_frozen();
+        return true;
+    }
+
+    if (state == FREEZE_FROZEN) {
+        if (!job_active) {
+            if ((int32_t)(hop_pos - emit_pos) > FREEZE_LEAD)
+                return false;
+            job_active = true;
+            job_step   = 0;
+        }
+        if (job_step == 0)
+            synthesis_build();
+        else if (job_step <= FFT_STEPS)
+            fft_step(&fft);
+        else
+            synthesis_overlap_add();
+
+        if (++job_step > FFT_STEPS + 1)
+            job_active = false;
+        return true;
+    }
+    return false;
+}
+
+static void capture(const int32_t *in) {
+    for (int i = 0; i < AUDIO_FRAME_SAMPLES; i++) {
+        int16_t *slot = history[captured & (FFT_SIZE - 1)];
+        for (int ch = 0; ch < AUDIO_NUM_CHANNELS; ch++)
+            slot[ch] = (int16_t)(in[i * AUDIO_NUM_CHANNELS + ch] >> 16);
+        captured++;
+    }
+    if (captured >= FFT_SIZE) {
+        state    = FREEZE_ANALYZE;
+        job_step = 0;
+    }
+}
+
+// Take one frame out of the overlap-add ring and clear it for the hops that follow.
+static void emit(void) {
+    for (int i = 0; i < AUDIO_FRAME_SAMPLES; i++) {
+        int32_t *slot = ola[(emit_pos + i) & (FREEZE_OLA_SIZE - 1)];
+        for (int ch = 0; ch < AUDIO_NUM_CHANNELS; ch++) {
+            wet_buf[i * AUDIO_NUM_CHANNELS + ch] = clamp32(slot[ch], (1 << 23) - 1) << 8;
+            slot[ch] = 0;
+        }
+    }
+}
+
+void fx_process(uint8_t *output, uint8_t *input) {
+    dsp_level_t *levels = meter_levels();
+    int32_t *in  = (int32_t *)input;
+    int32_t *out = (int32_t *)output;
+
+    if (state == FREEZE_CAPTURE)
+        capture(in);
+    for (int unit = 0; unit < FREEZE_UNITS; unit++) {
+        if (!run_unit())
+            break;
+    }
+
+    // Frames before wet_start still go out dry, but their slots hold partial sums of the first
+    // hops and must be cleared before the ring comes round to them again.
+    bool wet = false;
+    if (state == FREEZE_FROZEN) {
+        emit();
+        wet = (int32_t)(emit_pos - wet_start) >= 0;
+    }
+    if (wet) {
+        xfade_gain = dsp_crossfade(out, in, wet_buf, AUDIO_FRAME_SAMPLES, xfade_gain,
+                                   FREEZE_XFADE_STEP, levels);
+    } else {
+        if (output != input)
+            memcpy(output, input, AUDIO_FRAME_BYTES);
+        for (int i = 0; i < AUDIO_FRAME_SAMPLES; i++) {
+            for (int ch = 0; ch < AUDIO_NUM_CHANNELS; ch++)
+                dsp_level_add(&levels[ch], in[i * AUDIO_NUM_CHANNELS + ch]);
+        }
+    }
+    emit_pos += AUDIO_FRAME_SAMPLES;
+}
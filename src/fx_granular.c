@@ -0,0 +1,176 @@
+#include <string.h>
+#include "dsp.h"
+#include "fx.h"
+#include "grain.h"
+#include "meter.h"
+#include "perf.h"
+#include "ringbuffer.h"
+
+// Granular cloud: while the button is held, overlapping Hann-windowed grains are replayed from
+// the recent input. Grains are spawned evenly so `grain_limit` of them overlap, and the limit
+// follows the measured cost per grain up to the cycles this effect declares per frame.
+#define GRANULAR_HISTORY_FRAMES 8192     // power of two, 170 ms
+#define GRANULAR_SCATTER_MASK   4095     // random extra distance back into the history
+#define GRANULAR_MIN_GRAINS     2
+#define GRANULAR_CYCLE_BUDGET   60000    // declared worst case, see fx_cycles_per_frame()
+#define GRANULAR_BASE_CYCLES    8000     // history write, mix-down and metering
+
+static int16_t      history[GRANULAR_HISTORY_FRAMES * AUDIO_NUM_CHANNELS];
+static uint32_t     write_pos = 0;
+static uint32_t     history_fill = 0;  // frames written since the last resync, up to the ring
+static int32_t      mix[AUDIO_FRAME_SAMPLES * AUDIO_NUM_CHANNELS];
+static grain_pool_t pool;
+static bool         enabled = false;
+static uint32_t     grain_limit = GRANULAR_MIN_GRAINS;
+static uint32_t     grain_cycles = 0;  // running average cost of one grain for one frame
+static uint32_t     spawn_countdown = 0;
+static uint32_t     rng = 1;
+
+// Playback rates in Q16: mostly unison, some octaves down and up. At most 2x, so a grain
+// started GRAIN_LENGTH * 2 back never overtakes the write position.
+static const uint32_t grain_steps[] = {65536, 65536, 65536, 32768, 131072};
+#define NUM_GRAIN_STEPS (sizeof(grain_steps) / sizeof(grain_steps[0]))
+
+const char* fx_name(void) {
+    return "Pico Audio FX Granular";
+}
+
+void fx_init(void) {
+    grain_init();
+    grain_pool_reset(&pool);
+}
+
+uint32_t fx_cycles_per_frame(void) {
+    return GRANULAR_CYCLE_BUDGET;
+}
+
+// Grains replay history on purpose; there is no aligned signal to compensate.
+uint32_t fx_latency_samples(void) {
+    return 0;
+}
+
+// No tunable parameters yet.
+void fx_get_params(fx_params_t *params) {
+    memset(params, 0, sizeof(*params));
+}
+
+void fx_set_params(const fx_params_t *params) {
+    (void)params;
+}
+
+void fx_set_enable(bool enable) {
+    if (enable && !enabled) {
+        // Leaving bypass: the history was not written meanwhile, so drop it rather than let the
+        // first grains replay the previous press.
+        if (fx_is_idle()) {
+            memset(history, 0, sizeof(history));
+            write_pos = 0;
+            history_fill = 0;
+        }
+        spawn_countdown = 0;
+    }
+    enabled = enable;
+}
+
+// Grains already playing ring out after release.
+bool fx_is_idle(void) {
+    return !enabled && pool.active == 0;
+}
+
+// While engaged, silent input must still reach the history, and playing grains carry on
+// regardless of the input.
+bool fx_has_tail(void) {
+    return true;
+}
+
+uint32_t fx_status(void) {
+    return pool.active;
+}
+
+static uint32_t random_next(void) {
+    rng = rng * 1664525u + 1013904223u;
+    return rng >> 8;
+}
+
+static void spawn_grain(void) {
+    grain_t *g = grain_alloc(&pool, grain_limit);
+    if (g == NULL)
+        return;
+    uint32_t r = random_next();
+    uint32_t back = GRAIN_LENGTH * 2 + (r & GRANULAR_SCATTER_MASK);
+    uint32_t step = grain_steps[(r >> 12) % NUM_GRAIN_STEPS];
+    // Right after a resync only what was written since is real input: start within it, and play
+    // faster grains at unison until they can start far enough back not to overtake.
+    if (back > history_fill) {
+        back = history_fill;
+        if (step > 65536 && back < GRAIN_LENGTH * 2)
+            step = 65536;
+    }
+    g->pos  = (write_pos - back) << 16;
+    g->step = step;
+    g->age  = 0;
+}
+
+// Raise the limit one grain at a time while the next one still fits the budget; drop it at once
+// when the current cost does not.
+static void update_grain_limit(uint32_t render_cycles, uint32_t grains) {
+    if (grains == 0)
+        return;
+    uint32_t per_grain = render_cycles / grains;
+    grain_cycles = grain_cycles ? (grain_cycles * 7 + per_grain) / 8 : per_grain;
+
+    uint32_t fit = (GRANULAR_CYCLE_BUDGET - GRANULAR_BASE_CYCLES) / (grain_cycles + 1);
+    if (fit > GRAIN_POOL_SIZE)
+        fit = GRAIN_POOL_SIZE;
+    if (fit < GRANULAR_MIN_GRAINS)
+        fit = GRANULAR_MIN_GRAINS;
+    if (fit < grain_limit)
+        grain_limit = fit;
+    else if (fit > grain_limit && grains >= grain_limit)
+        grain_limit++;
+}
+
+void fx_process(uint8_t *output, uint8_t *input) {
+    dsp_level_t *levels = meter_levels();
+    const int32_t *in = (const int32_t *)input;
+    int32_t *out = (int32_t *)output;
+
+    for (int i = 0; i < AUDIO_FRAME_SAMPLES; i++) {
+        int16_t *slot = &history[(write_pos & (GRANULAR_HISTORY_FRAMES - 1)) * 2];
+        slot[0] = (int16_t)(in[i * 2] >> 16);
+        slot[1] = (int16_t)(in[i * 2 + 1] >> 16);
+        write_pos++;
+    }
+    history_fill += AUDIO_FRAME_SAMPLES;
+    if (history_fill > GRANULAR_HISTORY_FRAMES)
+        history_fill = GRANULAR_HISTORY_FRAMES;
+
+    // One spawn check per frame keeps the grain timing on a 1 ms grid, which the windows blur.
+    if (enabled) {
+        uint32_t interval = GRAIN_LENGTH / grain_limit;
+        if (spawn_countdown <= AUDIO_FRAME_SAMPLES) {
+            spawn_grain();
+            spawn_countdown += interval;
+        }
+        spawn_countdown -= AUDIO_FRAME_SAMPLES;
+    }
+
+    memset(mix, 0, sizeof(mix));
+    uint32_t grains = pool.active;
+    uint32_t start = perf_cycles();
+    grain_render(&pool, mix, history, GRANULAR_HISTORY_FRAMES, AUDIO_FRAME_SAMPLES);
+    update_grain_limit(perf_cycles_since(start), grains);
+
+    // Hann windows average 1/2, so `grain_limit` overlapping grains sum to about limit / 2.
+    // The mix stays below 16 * 2^23, so pre-shifting by 7 keeps the product within 32 bits.
+    int32_t gain = (2 << 11) / grain_limit;  // Q11
+    for (int i = 0; i < AUDIO_FRAME_SAMPLES * AUDIO_NUM_CHANNELS; i++) {
+        int32_t v = ((mix[i] >> 7) * gain) >> 4;
+        if (v > (1 << 23) - 1)
+            v = (1 << 23) - 1;
+        if (v < -(1 << 23))
+            v = -(1 << 23);
+        out[i] = v << 8;
+        dsp_level_add(&levels[i & 1], out[i]);
+    }
+}
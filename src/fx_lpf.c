@@ -1,61 +1,23 @@
 #include <math.h>
 #include <string.h>
 
+#include "dsp.h"
 #include "fx.h"
+#include "meter.h"
 #include "ringbuffer.h"
 
 #define FC_TABLE_SIZE 128
+#define LPF_STAGES 2
 
-typedef struct {
-    float b0, b1, b2;
-    float a1, a2;
-    float z1, z2;
-} biquad_t;
-
-static const float fc_min = 500.0f;
+static float fc_min = 500.0f;
 static const float fc_max = 24000.0f;
+static float lpf_q = 6.0f;
+static float sweep_down_step = 0.01f;  // per control tick
+static float sweep_up_step = 0.004f;
 static float fc_table[FC_TABLE_SIZE];
 static float fc_control = 0.0f;
-
-static void biquad_calc_lowpass(float fs, float fc, float q, float *b0, float *b1, float *b2,
-                                float *a1, float *a2) {
-    float omega = 2.0f * M_PI * (fc / fs);
-    float sin_omega = sinf(omega);
-    float cos_omega = cosf(omega);
-    float alpha = sin_omega / (2.0f * q);
-
-    float a0_inv = 1.0f / (1.0f + alpha);
-    *b0 = ((1.0f - cos_omega) / 2.0f) * a0_inv;
-    *b1 = (1.0f - cos_omega) * a0_inv;
-    *b2 = *b0;
-    *a1 = -2.0f * cos_omega * a0_inv;
-    *a2 = (1.0f - alpha) * a0_inv;
-}
-
-static void biquad_update_coeff(biquad_t *bq, float fs, float fc, float q) {
-    biquad_calc_lowpass(fs, fc, q, &bq->b0, &bq->b1, &bq->b2, &bq->a1, &bq->a2);
-}
-
-static void biquad_set(biquad_t *bq, float fs, float fc, float q) {
-    biquad_update_coeff(bq, fs, fc, q);
-    bq->z1 = 0.0f;
-    bq->z2 = 0.0f;
-}
-
-static float biquad_process(biquad_t *bq, float x) {
-    float y = bq->b0 * x + bq->b1 * bq->z1 + bq->b2 * bq->z2 - bq->a1 * bq->z1 - bq->a2 * bq->z2;
-    bq->z2 = bq->z1;
-    bq->z1 = y;
-    return y;
-}
-
-static void biquad_process_buffer(int32_t *buf, size_t frames, size_t stride, biquad_t *bq) {
-    for (size_t i = 0; i < frames; i++, buf += stride) {
-        float x = (float)(buf[0]) / (1 << 8);  // 24bitスロット →  float変換
-        float y = biquad_process(bq, x);
-        buf[0] = (int32_t)(y * (1 << 8));  // float →  24bitスロット
-    }
-}
+static bool coeffs_stale = false;
+static dsp_biquad_t lpf_l[LPF_STAGES], lpf_r[LPF_STAGES];
 
 static void init_fc_table(void) {
     const float gamma = 0.5f;
@@ -71,52 +33,112 @@ const char *fx_name(void) { return "Pico Audio FX LPF"; }
 
 void fx_init(void) { init_fc_table(); }
 
+// Estimated for RP2040 soft float at about 60 cycles per float add or multiply: four biquad
+// passes of 48 samples at roughly 700 cycles each, a sinf/cosf coefficient update and the
+// pipeline's crossfade.
+uint32_t fx_cycles_per_frame(void) { return 150000; }
+
+// The biquads are causal IIR sections: their phase shift is not a fixed delay to compensate.
+uint32_t fx_latency_samples(void) { return 0; }
+
+static int32_t clamp_param(int32_t value, int32_t min, int32_t max) {
+    return value < min ? min : (value > max ? max : value);
+}
+
+// values[0]: lowest cutoff (Hz), values[1]: resonance Q x 100, values[2]/[3]: sweep down/up
+// time (ms). Cutoff and Q are held to the range tools/dsptest checks the kernels over: lower
+// cutoffs are ill-conditioned in single precision, and higher Q overloads the two stages.
+void fx_get_params(fx_params_t *params) {
+    params->values[0] = (int32_t)lroundf(fc_min);
+    params->values[1] = (int32_t)lroundf(lpf_q * 100.0f);
+    params->values[2] = (int32_t)lroundf(1.0f / sweep_down_step);
+    params->values[3] = (int32_t)lroundf(1.0f / sweep_up_step);
+}
+
+void fx_set_params(const fx_params_t *params) {
+    fc_min = (float)clamp_param(params->values[0], 500, 5000);
+    lpf_q = (float)clamp_param(params->values[1], 50, 600) / 100.0f;
+    sweep_down_step = 1.0f / (float)clamp_param(params->values[2], 1, 5000);
+    sweep_up_step = 1.0f / (float)clamp_param(params->values[3], 1, 5000);
+    init_fc_table();
+    coeffs_stale = true;
+}
+
+// Called once per control tick (1 ms): ~100 ms sweep down, ~250 ms back up by default.
 void fx_set_enable(bool enable) {
     if (enable) {
-        fc_control -= 0.0005f;
+        // Leaving bypass: the filter state still holds the last frame before it, which may be
+        // minutes old. Start from rest; fully open, the cascade passes the input unchanged.
+        if (fx_is_idle()) {
+            for (int s = 0; s < LPF_STAGES; s++) {
+                dsp_biquad_reset(&lpf_l[s]);
+                dsp_biquad_reset(&lpf_r[s]);
+            }
+        }
+        fc_control -= sweep_down_step;
         if (fc_control < 0.0f)
             fc_control = 0.0f;
 
     } else {
-        fc_control += 0.0002f;
+        fc_control += sweep_up_step;
         if (fc_control > 1.0f)
             fc_control = 1.0f;
     }
 }
 
-void fx_process(uint8_t *output, uint8_t *input) {
+// Fully open the cascade is transparent (at fc = fs/2 the folded taps are zero).
+bool fx_is_idle(void) { return fc_control >= 1.0f; }
+
+// The filter only rings out while its state is above one 24-bit LSB.
+bool fx_has_tail(void) {
+    for (int s = 0; s < LPF_STAGES; s++) {
+        if (fabsf(lpf_l[s].z1) >= 1.0f || fabsf(lpf_l[s].z2) >= 1.0f ||
+            fabsf(lpf_r[s].z1) >= 1.0f || fabsf(lpf_r[s].z2) >= 1.0f)
+            return true;
+    }
+    return false;
+}
+
+static float current_cutoff(void) {
     int index = (int)(fc_control * (FC_TABLE_SIZE - 1));
     if (index < 0)
         index = 0;
     if (index >= FC_TABLE_SIZE)
         index = FC_TABLE_SIZE - 1;
-    float fc_current = fc_table[index];
+    return fc_table[index];
+}
+
+uint32_t fx_status(void) { return (uint32_t)current_cutoff(); }
+
+void fx_process(uint8_t *output, uint8_t *input) {
+    float fc_current = current_cutoff();
 
-    static biquad_t lpf_l, lpf_r;
-    static biquad_t lpf_l2, lpf_r2;
     static bool initialized = false;
     if (!initialized) {
-        biquad_set(&lpf_l, 48000.0f, fc_current, 6.0f);
-        biquad_set(&lpf_r, 48000.0f, fc_current, 6.0f);
-        biquad_set(&lpf_l2, 48000.0f, fc_current, 6.0f);
-        biquad_set(&lpf_r2, 48000.0f, fc_current, 6.0f);
+        for (int s = 0; s < LPF_STAGES; s++) {
+            dsp_biquad_lowpass(&lpf_l[s], 48000.0f, fc_current, lpf_q);
+            dsp_biquad_lowpass(&lpf_r[s], 48000.0f, fc_current, lpf_q);
+            dsp_biquad_reset(&lpf_l[s]);
+            dsp_biquad_reset(&lpf_r[s]);
+        }
         initialized = true;
     }
 
-    memcpy(output, input, AUDIO_FRAME_BYTES);
+    if (output != input)
+        memcpy(output, input, AUDIO_FRAME_BYTES);
 
     size_t stride = 2;
     size_t frames = AUDIO_FRAME_SAMPLES;
     static float fc_prev = 0.0f;
-    if (fabsf(fc_current - fc_prev) > 100.0f) {
-        biquad_update_coeff(&lpf_l, 48000.0f, fc_current, 6.0f);
-        biquad_update_coeff(&lpf_r, 48000.0f, fc_current, 6.0f);
-        biquad_update_coeff(&lpf_l2, 48000.0f, fc_current, 6.0f);
-        biquad_update_coeff(&lpf_r2, 48000.0f, fc_current, 6.0f);
+    if (coeffs_stale || fabsf(fc_current - fc_prev) > 100.0f) {
+        for (int s = 0; s < LPF_STAGES; s++) {
+            dsp_biquad_lowpass(&lpf_l[s], 48000.0f, fc_current, lpf_q);
+            dsp_biquad_lowpass(&lpf_r[s], 48000.0f, fc_current, lpf_q);
+        }
         fc_prev = fc_current;
+        coeffs_stale = false;
     }
-    biquad_process_buffer((int32_t *)output + 0, frames, stride, &lpf_l);
-    biquad_process_buffer((int32_t *)output + 0, frames, stride, &lpf_l2);
-    biquad_process_buffer((int32_t *)output + 1, frames, stride, &lpf_r);
-    biquad_process_buffer((int32_t *)output + 1, frames, stride, &lpf_r2);
+    dsp_level_t *levels = meter_levels();
+    dsp_biquad_cascade((int32_t *)output + 0, frames, stride, lpf_l, LPF_STAGES, &levels[0]);
+    dsp_biquad_cascade((int32_t *)output + 1, frames, stride, lpf_r, LPF_STAGES, &levels[1]);
 }
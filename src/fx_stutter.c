@@ -1,17 +1,24 @@
 #include <string.h>
 #include <stdlib.h>
+#include "dsp.h"
 #include "fx.h"
+#include "meter.h"
 #include "ringbuffer.h"
 
 #define STUTTER_FRAMES  63
 #define STUTTER_SAMPLES   (AUDIO_FRAME_SAMPLES * STUTTER_FRAMES)
+#define STUTTER_RELEASE_STEP (DSP_GAIN_UNITY / (4 * AUDIO_FRAME_SAMPLES))  // 4 ms back to input
 
 static int32_t sample_buffer[STUTTER_SAMPLES][AUDIO_NUM_CHANNELS];
+static int32_t loop_frame[AUDIO_FRAME_SAMPLES * AUDIO_NUM_CHANNELS];
 static bool     recording    = false;
 static bool     stuttering   = false;
+static bool     releasing    = false;
+static int32_t  release_gain = 0;  // share of the input while releasing, Q15
 static bool     prev_enabled = false;
 static uint32_t rec_pos      = 0;
 static uint32_t read_pos     = 0;
+static uint32_t loop_samples = STUTTER_SAMPLES;
 
 const char* fx_name(void) {
     return "Pico Audio FX Stutter";
@@ -20,21 +27,88 @@ const char* fx_name(void) {
 void fx_init(void) {
 }
 
+// Estimated: the release crossfade out of the loop with metering, about 60 cycles per stereo
+// sample, plus the pipeline's crossfade.
+uint32_t fx_cycles_per_frame(void) {
+    return 8000;
+}
+
+// Passes input straight through until the loop plays; the loop itself is not delayed input.
+uint32_t fx_latency_samples(void) {
+    return 0;
+}
+
+// values[0]: loop length in 1 ms frames, up to STUTTER_FRAMES.
+void fx_get_params(fx_params_t *params) {
+    memset(params, 0, sizeof(*params));
+    params->values[0] = loop_samples / AUDIO_FRAME_SAMPLES;
+}
+
+void fx_set_params(const fx_params_t *params) {
+    int32_t frames = params->values[0];
+    if (frames < 1)
+        frames = 1;
+    if (frames > STUTTER_FRAMES)
+        frames = STUTTER_FRAMES;
+    loop_samples = frames * AUDIO_FRAME_SAMPLES;
+    if (rec_pos >= loop_samples)
+        rec_pos = loop_samples - 1;
+    if (read_pos >= loop_samples)
+        read_pos = 0;
+}
+
 void fx_set_enable(bool enable) {
     if (enable && !prev_enabled) {
         recording  = true;
         stuttering = false;
+        releasing  = false;
         rec_pos    = 0;
         read_pos   = 0;
     }
     if (!enable) {
-        recording  = false;
-        stuttering = false;
+        recording = false;
+        if (stuttering && !releasing) {
+            releasing    = true;
+            release_gain = 0;
+        }
     }
     prev_enabled = enable;
 }
 
+// Going straight to pass-through on release would leave the pipeline's fade blending dry into
+// dry, so the loop is faded back to the input here and idle is reported only once that is done.
+bool fx_is_idle(void) {
+    return !recording && !stuttering;
+}
+
+// Recording must see every frame, silent or not, and the loop plays regardless of input.
+bool fx_has_tail(void) {
+    return true;
+}
+
+uint32_t fx_status(void) {
+    return stuttering ? read_pos : rec_pos;
+}
+
+// Copy the next frame of the loop to `dst`, metering it unless `levels` is NULL.
+static void play_loop(int32_t *dst, dsp_level_t *levels) {
+    for (int i = 0; i < AUDIO_FRAME_SAMPLES; i++) {
+        for (int ch = 0; ch < AUDIO_NUM_CHANNELS; ch++) {
+            int32_t s = sample_buffer[read_pos][ch];
+            dst[i * AUDIO_NUM_CHANNELS + ch] = s;
+            if (levels)
+                dsp_level_add(&levels[ch], s);
+        }
+        read_pos++;
+        if (read_pos >= loop_samples) {
+            read_pos = 0;
+        }
+    }
+}
+
 void fx_process(uint8_t *output, uint8_t *input) {
+    dsp_level_t *levels = meter_levels();
+
     if (recording) {
         for (int i = 0; i < AUDIO_FRAME_SAMPLES; i++) {
             for (int ch = 0; ch < AUDIO_NUM_CHANNELS; ch++) {
@@ -43,34 +117,38 @@ void fx_process(uint8_t *output, uint8_t *input) {
                        &input[(i * AUDIO_NUM_CHANNELS + ch) * AUDIO_BYTES_PER_SAMPLE],
                        sizeof(s));
                 sample_buffer[rec_pos][ch] = s;
+                dsp_level_add(&levels[ch], s);
             }
             rec_pos++;
-            if (rec_pos >= STUTTER_SAMPLES) {
+            if (rec_pos >= loop_samples) {
                 recording  = false;
                 stuttering = true;
                 rec_pos    = 0;  // reset for potential next record
                 break;
             }
         }
-        memcpy(output, input, AUDIO_FRAME_BYTES);
+        if (output != input)
+            memcpy(output, input, AUDIO_FRAME_BYTES);
+        return;
+    }
+
+    if (stuttering && !releasing) {
+        play_loop((int32_t *)output, levels);
         return;
     }
 
     if (stuttering) {
-        for (int i = 0; i < AUDIO_FRAME_SAMPLES; i++) {
-            for (int ch = 0; ch < AUDIO_NUM_CHANNELS; ch++) {
-                int32_t s = sample_buffer[read_pos][ch];
-                memcpy(&output[(i * AUDIO_NUM_CHANNELS + ch) * AUDIO_BYTES_PER_SAMPLE],
-                       &s,
-                       sizeof(s));
-            }
-            read_pos++;
-            if (read_pos >= STUTTER_SAMPLES) {
-                read_pos = 0;
-            }
+        play_loop(loop_frame, NULL);
+        release_gain = dsp_crossfade((int32_t *)output, loop_frame, (int32_t *)input,
+                                     AUDIO_FRAME_SAMPLES, release_gain, STUTTER_RELEASE_STEP,
+                                     levels);
+        if (release_gain >= DSP_GAIN_UNITY) {
+            stuttering = false;
+            releasing  = false;
         }
         return;
     }
 
-    memcpy(output, input, AUDIO_FRAME_BYTES);
+    if (output != input)
+        memcpy(output, input, AUDIO_FRAME_BYTES);
 }
@@ -1,7 +1,9 @@
 #include <math.h>
 #include <string.h>
 
+#include "dsp.h"
 #include "fx.h"
+#include "meter.h"
 #include "ringbuffer.h"
 
 static float playback_pos = 0.0f;
@@ -10,13 +12,15 @@ static bool is_slowing_down = false;
 static bool is_recovering = false;
 
 static float prev_out_l = 0.0f, prev_out_r = 0.0f;
-static const float frame_slow_factor = 0.995213f;
+static float frame_slow_factor = 0.995213f;
+static float recover_rate = 0.003f;
 static const float fs = 48000.0f;
 static const float nyquist = fs * 0.5f;
 static const float dt = 1.0f / fs;
 
 static int32_t sample_buffer[TOTAL_SAMPLES][AUDIO_NUM_CHANNELS];
 static volatile uint32_t write_sample_pos = 0;
+static int32_t filtered[AUDIO_FRAME_SAMPLES * AUDIO_NUM_CHANNELS];
 
 #define FC_TABLE_SIZE 256
 #define MIX_TABLE_SIZE 256
@@ -50,8 +54,50 @@ void fx_init(void) {
     init_fc_table();
 }
 
+// Estimated for RP2040 soft float at about 60 cycles per float add or multiply: roughly 1400
+// cycles per stereo sample to interpolate, filter and mix, plus the pipeline's crossfade.
+uint32_t fx_cycles_per_frame(void) { return 80000; }
+
+// Back at full speed. Playback may still lag the write head after a stop; the pipeline fades
+// that out to the dry signal.
+bool fx_is_idle(void) { return !is_slowing_down && !is_recovering; }
+
+// Playback reads from history, so silence in does not mean silence out.
+bool fx_has_tail(void) { return true; }
+
+uint32_t fx_status(void) { return (uint32_t)(playback_speed * 65536.0f); }
+
+// At full speed playback reads the sample just written.
+uint32_t fx_latency_samples(void) { return 0; }
+
+static int32_t clamp_param(int32_t value, int32_t min, int32_t max) {
+    return value < min ? min : (value > max ? max : value);
+}
+
+// values[0]: speed half-life while stopping, values[1]: recovery time constant, both in ms
+// (one frame each).
+void fx_get_params(fx_params_t *params) {
+    memset(params, 0, sizeof(*params));
+    params->values[0] = (int32_t)lroundf(logf(0.5f) / logf(frame_slow_factor));
+    params->values[1] = (int32_t)lroundf(1.0f / recover_rate);
+}
+
+void fx_set_params(const fx_params_t *params) {
+    int32_t half_life_ms = clamp_param(params->values[0], 10, 2000);
+    int32_t recover_ms = clamp_param(params->values[1], 10, 5000);
+    frame_slow_factor = powf(0.5f, 1.0f / (float)half_life_ms);
+    recover_rate = 1.0f / (float)recover_ms;
+}
+
 void fx_set_enable(bool enable) {
     if (enable) {
+        // Leaving bypass: the history was not written meanwhile, so restart playback at the
+        // write head. At speed 1.0 that reads back the incoming frame with zero latency,
+        // matching the dry signal the pipeline fades from.
+        if (fx_is_idle()) {
+            playback_pos = (float)write_sample_pos;
+            playback_speed = 1.0f;
+        }
         is_slowing_down = true;
         is_recovering = false;
     } else {
@@ -80,7 +126,7 @@ void fx_process(uint8_t *output, uint8_t *input) {
             playback_speed = 0.0f;
     }
     if (is_recovering) {
-        playback_speed += (1.0f - playback_speed) * 0.003f;
+        playback_speed += (1.0f - playback_speed) * recover_rate;
         if (playback_speed >= 0.999f) {
             playback_speed = 1.0f;
             is_recovering = false;
@@ -94,42 +140,28 @@ void fx_process(uint8_t *output, uint8_t *input) {
     alpha = fmaxf(alpha, 0.001f);
 
     int32_t *out_ptr = (int32_t *)output;
-    for (size_t i = 0; i < frames; i++) {
-        int pos_int = ((int)playback_pos) % TOTAL_SAMPLES;
-        int next_pos = (pos_int + 1) % TOTAL_SAMPLES;
-        float frac = playback_pos - floorf(playback_pos);
+    playback_pos = dsp_resample(out_ptr, &sample_buffer[0][0], TOTAL_SAMPLES, playback_pos, speed,
+                                frames);
 
-        for (int ch = 0; ch < AUDIO_NUM_CHANNELS; ch++) {
-            int32_t s1 = sample_buffer[pos_int][ch];
-            int32_t s2 = sample_buffer[next_pos][ch];
-            int32_t interp = (frac < 1e-4f) ? s1 : (int32_t)(s1 * (1.0f - frac) + s2 * frac);
-
-            float raw_f = (float)interp;
-            float filt_f = (ch == 0) ? (prev_out_l + alpha * (raw_f - prev_out_l))
-                                     : (prev_out_r + alpha * (raw_f - prev_out_r));
-            if (ch == 0)
-                prev_out_l = filt_f;
-            else
-                prev_out_r = filt_f;
-
-            float norm = (speed <= 0.0f) ? 0.0f : speed / 0.9f;
-            float mix = 1.0f;
-            if (speed < 0.9f) {
-                int index = (int)(norm * (MIX_TABLE_SIZE - 1));
-                if (index < 0)
-                    index = 0;
-                if (index >= MIX_TABLE_SIZE)
-                    index = MIX_TABLE_SIZE - 1;
-                mix = mix_table[index];
-            }
-
-            *out_ptr++ = (int32_t)(filt_f * (1.0f - mix) + raw_f * mix);
-        }
+    for (size_t i = 0; i < frames; i++) {
+        float raw_l = (float)out_ptr[i * AUDIO_NUM_CHANNELS + 0];
+        float raw_r = (float)out_ptr[i * AUDIO_NUM_CHANNELS + 1];
+        prev_out_l = prev_out_l + alpha * (raw_l - prev_out_l);
+        prev_out_r = prev_out_r + alpha * (raw_r - prev_out_r);
+        filtered[i * AUDIO_NUM_CHANNELS + 0] = (int32_t)prev_out_l;
+        filtered[i * AUDIO_NUM_CHANNELS + 1] = (int32_t)prev_out_r;
+    }
 
-        if (speed > 0.0f) {
-            playback_pos += speed;
-            if (playback_pos >= TOTAL_SAMPLES)
-                playback_pos -= TOTAL_SAMPLES;
-        }
+    float norm = (speed <= 0.0f) ? 0.0f : speed / 0.9f;
+    float mix = 1.0f;
+    if (speed < 0.9f) {
+        int index = (int)(norm * (MIX_TABLE_SIZE - 1));
+        if (index < 0)
+            index = 0;
+        if (index >= MIX_TABLE_SIZE)
+            index = MIX_TABLE_SIZE - 1;
+        mix = mix_table[index];
     }
+    int32_t gain = (int32_t)(mix * DSP_GAIN_UNITY);
+    dsp_crossfade(out_ptr, filtered, out_ptr, frames, gain, 0, meter_levels());
 }
@@ -0,0 +1,77 @@
+/*
+ * Copyright 2025, Hiroyuki OYAMA
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+#include "grain.h"
+
+#include <math.h>
+#include <string.h>
+
+#define GRAIN_WINDOW_SHIFT 2  // log2(GRAIN_LENGTH / GRAIN_WINDOW_SIZE)
+
+static int16_t window_table[GRAIN_WINDOW_SIZE];
+
+void grain_init(void) {
+    for (int i = 0; i < GRAIN_WINDOW_SIZE; i++) {
+        float w = 0.5f - 0.5f * cosf(2.0f * (float)M_PI * i / GRAIN_WINDOW_SIZE);
+        window_table[i] = (int16_t)lroundf(w * 32767.0f);
+    }
+}
+
+void grain_pool_reset(grain_pool_t *pool) {
+    for (int i = 0; i < GRAIN_POOL_SIZE; i++)
+        pool->grains[i].age = GRAIN_LENGTH;
+    pool->active = 0;
+    pool->stolen = 0;
+}
+
+grain_t *grain_alloc(grain_pool_t *pool, uint32_t limit) {
+    grain_t *oldest = NULL;
+    for (int i = 0; i < GRAIN_POOL_SIZE; i++) {
+        grain_t *g = &pool->grains[i];
+        if (g->age >= GRAIN_LENGTH) {
+            if (pool->active < limit) {
+                pool->active++;
+                return g;
+            }
+            continue;
+        }
+        if (oldest == NULL || g->age > oldest->age)
+            oldest = g;
+    }
+    if (oldest != NULL)
+        pool->stolen++;
+    return oldest;
+}
+
+void grain_render(grain_pool_t *pool, int32_t *mix, const int16_t *history,
+                  uint32_t history_frames, size_t frames) {
+    const uint32_t mask = history_frames - 1;
+
+    for (int i = 0; i < GRAIN_POOL_SIZE; i++) {
+        grain_t *g = &pool->grains[i];
+        if (g->age >= GRAIN_LENGTH)
+            continue;
+
+        uint32_t pos = g->pos;
+        uint32_t age = g->age;
+        size_t n = GRAIN_LENGTH - age;
+        if (n > frames)
+            n = frames;
+        int32_t *out = mix;
+        for (size_t f = 0; f < n; f++) {
+            int32_t w = window_table[age >> GRAIN_WINDOW_SHIFT];
+            const int16_t *s = &history[((pos >> 16) & mask) * 2];
+            out[0] += (s[0] * w) >> 7;  // 16-bit x Q15 -> 24-bit
+            out[1] += (s[1] * w) >> 7;
+            out += 2;
+            pos += g->step;
+            age++;
+        }
+        g->pos = pos;
+        g->age = age;
+        if (age >= GRAIN_LENGTH)
+            pool->active--;
+    }
+}
@@ -9,77 +9,358 @@
 
 #include "bootsel_button.h"
 #include "bsp/board_api.h"
+#include "clock_governor.h"
+#include "dsp.h"
 #include "fx.h"
 #include "hardware/clocks.h"
+#include "hardware/structs/usb.h"
+#include "hardware/sync.h"
 #include "led.h"
+#include "meter.h"
+#include "perf.h"
 #include "pico/stdlib.h"
+#include "preset.h"
 #include "ringbuffer.h"
 #include "tusb.h"
 #include "usb_descriptors.h"
 
-static ringbuf_t rx_ringbuf = {0};
-static ringbuf_t tx_ringbuf = {0};
+#define CONTROL_TICK_MS 1
+#define FADE_FRAMES 4  // bypass <-> effect crossfade length in 1 ms frames
+#define FADE_STEP (DSP_GAIN_UNITY / (FADE_FRAMES * AUDIO_FRAME_SAMPLES))
+#define LATENCY_WINDOW_FRAMES 1000  // IN pre-loads over which the ring delay is tracked
+#define USB_FRAME_US 1000           // full-speed frame: one IN token per endpoint
+#define LATENCY_HYSTERESIS_US 250   // smaller drops of the ring delay are not reported
+#define PRESET_IDLE_US 100000  // no OUT frame for this long: the host has stopped streaming
+
+typedef enum {
+    ROUTE_BYPASS,
+    ROUTE_FADE_IN,
+    ROUTE_ACTIVE,
+    ROUTE_FADE_OUT,
+} route_t;
+
+static ringbuf_t ringbuf = {0};
 
 static uint8_t silence_buf[AUDIO_FRAME_BYTES] = {0};
+static int32_t dry_buf[AUDIO_FRAME_SAMPLES * AUDIO_NUM_CHANNELS];
+
+static volatile uint32_t last_rx_us = 0;
+static volatile uint32_t rx_irq_us = 0;  // USB interrupt that completed the pending OUT transfer
+static volatile bool rx_irq_stamped = false;
+static volatile uint32_t rx_done_sof = 0;  // USB frame number of the last OUT callback
+static volatile bool rx_stream_open = false;  // speaker alt setting active, so stamps are its own
+
+static uint32_t ring_delay_us = 0;
+static uint32_t ring_delay_window_max = 0;
+static uint32_t ring_delay_window_ticks = 0;
+
+static route_t route = ROUTE_BYPASS;
+static int32_t wet_gain = 0;
+
+static repeating_timer_t control_timer;
+static volatile bool control_pending = false;
+
+static bool frame_is_silent(const uint8_t *frame) {
+    const int32_t *samples = (const int32_t *)frame;
+    int32_t acc = 0;
+    for (int i = 0; i < AUDIO_FRAME_SAMPLES * AUDIO_NUM_CHANNELS; i++)
+        acc |= samples[i];
+    return acc == 0;
+}
+
+// Run one frame through the effect in place. While the effect is idle the frame is left
+// untouched and goes out of the slot it arrived in; entering and leaving bypass crossfades
+// between the dry and wet signal, both at zero latency.
+static void process_frame(uint8_t *frame) {
+    bool idle = fx_is_idle();
+    switch (route) {
+        case ROUTE_BYPASS:
+            if (idle) {
+                meter_scan(frame);
+                perf_count(PERF_COUNTER_FX_BYPASSED);
+                return;
+            }
+            route = ROUTE_FADE_IN;
+            break;
+        case ROUTE_ACTIVE:
+            if (idle)
+                route = ROUTE_FADE_OUT;
+            break;
+        case ROUTE_FADE_IN:
+        case ROUTE_FADE_OUT:
+            route = idle ? ROUTE_FADE_OUT : ROUTE_FADE_IN;
+            break;
+    }
+
+    if (route == ROUTE_ACTIVE) {
+        if (!fx_has_tail() && frame_is_silent(frame)) {
+            perf_count(PERF_COUNTER_FX_SILENT);
+            return;
+        }
+        uint32_t start = perf_cycles();
+        fx_process(frame, frame);
+        perf_record(PERF_STAT_FX_CYCLES, perf_cycles_since(start));
+        return;
+    }
+
+    memcpy(dry_buf, frame, AUDIO_FRAME_BYTES);
+    fx_process(frame, frame);
+    meter_begin_frame();  // meter the blend rather than the wet signal alone
+    int32_t step = (route == ROUTE_FADE_IN) ? FADE_STEP : -FADE_STEP;
+    wet_gain = dsp_crossfade((int32_t *)frame, dry_buf, (int32_t *)frame, AUDIO_FRAME_SAMPLES,
+                             wet_gain, step, meter_levels());
+    if (wet_gain >= DSP_GAIN_UNITY)
+        route = ROUTE_ACTIVE;
+    else if (wet_gain <= 0)
+        route = ROUTE_BYPASS;
+}
 
+// Process every frame that has arrived. In the event-driven build this runs straight from the
+// OUT transfer completion, so processing starts at frame arrival.
 void audio_task(void) {
+    while (ringbuf.process_idx != ringbuf.write_idx) {
+        uint32_t arrival_us = ringbuf.arrival_us[ringbuf.process_idx];
+
+        perf_record(PERF_STAT_DISPATCH_US, time_us_32() - arrival_us);
+        uint32_t start = perf_cycles();
+        meter_begin_frame();
+        process_frame(ringbuf.buffer[ringbuf.process_idx]);
+        meter_end_frame();
+        uint32_t cycles = perf_cycles_since(start);
+        perf_record(PERF_STAT_DSP_CYCLES, cycles);
+        clock_governor_record(cycles);
+
+        ringbuf.process_idx = (ringbuf.process_idx + 1) % RINGBUF_FRAMES;
+    }
+}
+
+// The effect's worst case is reserved in the tick that engages it, so the clock is raised
+// before its first frame and the crossfade rather than after an overrun.
+void control_task(void) {
     fx_set_enable(bb_get_bootsel_button());
+    clock_governor_reserve(fx_is_idle() ? 0 : fx_cycles_per_frame());
+}
 
-    if (rx_ringbuf.read_idx != rx_ringbuf.write_idx &&
-        (tx_ringbuf.write_idx + 1) % RINGBUF_FRAMES != tx_ringbuf.read_idx) {
-        uint8_t *input = rx_ringbuf.buffer[rx_ringbuf.read_idx];
-        uint8_t *output = tx_ringbuf.buffer[tx_ringbuf.write_idx];
+void led_task(void) { led_update(); }
 
-        fx_process(output, input);
+// Time from OUT arrival to the IN pre-load, plus the USB frame the pre-loaded packet waits for
+// the next IN token, plus the effect's own delay. The effect delay is counted even while
+// bypassed so the host's compensation does not jump on every button press. Called every tick,
+// so a change notification that could not be queued is sent again.
+void latency_task(void) {
+    uint64_t latency_ns = ((uint64_t)ring_delay_us + USB_FRAME_US) * 1000u;
+    latency_ns += (uint64_t)fx_latency_samples() * 1000000000u / AUDIO_SAMPLE_RATE;
+    usb_set_latency_ns(latency_ns > UINT32_MAX ? UINT32_MAX : (uint32_t)latency_ns);
+}
 
-        tx_ringbuf.write_idx = (tx_ringbuf.write_idx + 1) % RINGBUF_FRAMES;
-        rx_ringbuf.read_idx = (rx_ringbuf.read_idx + 1) % RINGBUF_FRAMES;
+// Parameters from the host apply at once; saving them waits until the audio path is idle.
+// Without OUT frames the IN stream carries only silence, so stalling it is inaudible.
+void preset_command_task(void) {
+    preset_command_t command;
+    if (tud_vendor_mounted() && tud_vendor_available() >= sizeof(command) &&
+        tud_vendor_read(&command, sizeof(command)) == sizeof(command) &&
+        command.version == PRESET_COMMAND_VERSION) {
+        fx_params_t params;
+        memcpy(&params, &command.params, sizeof(params));
+        fx_set_params(&params);
+        if (command.flags & PRESET_FLAG_SAVE)
+            preset_save(&params);
     }
+
+    bool audio_idle = !tud_mounted() || time_us_32() - last_rx_us >= PRESET_IDLE_US;
+    preset_task(audio_idle);
 }
 
-void led_task(void) { led_update(); }
+// Vendor requests arrive from tud_task(), in the same context as fx_set_params().
+bool tud_vendor_control_xfer_cb(uint8_t rhport, uint8_t stage,
+                                tusb_control_request_t const *request) {
+    static preset_command_t reply;
+    if (request->bmRequestType_bit.type != TUSB_REQ_TYPE_VENDOR ||
+        request->bmRequestType_bit.direction != TUSB_DIR_IN ||
+        request->bRequest != PRESET_REQUEST_GET)
+        return false;
+    if (stage != CONTROL_STAGE_SETUP)
+        return true;
+
+    fx_params_t params;
+    fx_get_params(&params);
+    reply = (preset_command_t){.version = PRESET_COMMAND_VERSION};
+    memcpy(&reply.params, &params, sizeof(params));
+    return tud_control_xfer(rhport, request, &reply, sizeof(reply));
+}
+
+void meter_task(void) {
+    meter_report_t report;
+    if (!meter_take_report(&report))
+        return;
+    if (!tud_vendor_mounted() || tud_vendor_write_available() < sizeof(report))
+        return;
+
+    report.flags = (route != ROUTE_BYPASS) ? METER_FLAG_FX_ACTIVE : 0;
+    report.fx_status = fx_status();
+    tud_vendor_write(&report, sizeof(report));
+    tud_vendor_write_flush();
+}
+
+static bool control_timer_cb(repeating_timer_t *rt) {
+    (void)rt;
+    control_pending = true;
+    return true;
+}
+
+#ifndef FX_SCHED_POLLING
+// Sleep until the USB or timer interrupt has something for us. WFI wakes on a pending
+// interrupt even while PRIMASK is set, so checking with interrupts masked closes the race
+// between the test and the sleep.
+static void wait_for_event(void) {
+    uint32_t flags = save_and_disable_interrupts();
+    if (!tud_task_event_ready() && !control_pending)
+        __wfi();
+    restore_interrupts(flags);
+}
+#endif
+
+// Dispatch jitter changes the delay from frame to frame, so the longest delay is kept: increases
+// take effect at once. A full window whose longest delay is more than LATENCY_HYSTERESIS_US
+// shorter lowers it; smaller drops are ignored, as the next window usually brings them back.
+static void track_ring_delay(uint32_t delay_us) {
+    if (delay_us > ring_delay_window_max)
+        ring_delay_window_max = delay_us;
+    if (delay_us > ring_delay_us)
+        ring_delay_us = delay_us;
+    if (++ring_delay_window_ticks >= LATENCY_WINDOW_FRAMES) {
+        if (ring_delay_window_max + LATENCY_HYSTERESIS_US < ring_delay_us)
+            ring_delay_us = ring_delay_window_max;
+        ring_delay_window_max = 0;
+        ring_delay_window_ticks = 0;
+    }
+}
+
+// Called from the USB interrupt for every event TinyUSB queues, long before tud_task()
+// dispatches it. The OUT endpoint is re-armed only after its callback, so the first transfer
+// completion that finds it disarmed is its own; events later in the frame of the last callback
+// are skipped, as the endpoint may not be re-armed yet. Outside an open OUT stream the endpoint
+// is disarmed too, so nothing is stamped then. The stamp is the frame's real arrival, so
+// dispatch_us includes the wake-up and dispatch path.
+void tud_event_hook_cb(uint8_t rhport, uint32_t eventid, bool in_isr) {
+    (void)rhport;
+    if (!in_isr || !rx_stream_open || eventid != DCD_EVENT_XFER_COMPLETE || rx_irq_stamped)
+        return;
+    if ((usb_hw->sof_rd & USB_SOF_RD_BITS) == rx_done_sof)
+        return;
+    if (!(usb_dpram->ep_buf_ctrl[EPNUM_AUDIO_OUT].out & USB_BUF_CTRL_AVAIL)) {
+        rx_irq_us = time_us_32();
+        rx_irq_stamped = true;
+    }
+}
 
 bool tud_audio_rx_done_pre_read_cb(uint8_t rhport, uint16_t n_bytes_received, uint8_t func_id,
                                    uint8_t ep_out, uint8_t cur_alt_setting) {
-    uint8_t next_write = (rx_ringbuf.write_idx + 1) % RINGBUF_FRAMES;
-    if (next_write == rx_ringbuf.read_idx) {
+    uint32_t arrival_us = rx_irq_stamped ? rx_irq_us : time_us_32();
+    rx_irq_stamped = false;
+    rx_done_sof = usb_hw->sof_rd & USB_SOF_RD_BITS;
+
+    uint8_t next_write = (ringbuf.write_idx + 1) % RINGBUF_FRAMES;
+    if (next_write == ringbuf.read_idx) {
+        perf_count(PERF_COUNTER_RX_DROPPED);
         return true;
     }
 
-    uint16_t rx_size = tud_audio_read(rx_ringbuf.buffer[rx_ringbuf.write_idx], n_bytes_received);
+    uint16_t rx_size = tud_audio_read(ringbuf.buffer[ringbuf.write_idx], n_bytes_received);
     if (rx_size != n_bytes_received)
         return true;
-    rx_ringbuf.write_idx = next_write;
+    ringbuf.arrival_us[ringbuf.write_idx] = arrival_us;
+    last_rx_us = ringbuf.arrival_us[ringbuf.write_idx];
+    ringbuf.write_idx = next_write;
+#ifndef FX_SCHED_POLLING
+    audio_task();
+#endif
     return true;
 }
 
 bool tud_audio_tx_done_pre_load_cb(uint8_t rhport, uint8_t itf, uint8_t ep_in,
                                    uint8_t cur_alt_setting) {
-    if (tx_ringbuf.read_idx == tx_ringbuf.write_idx) {
+    if (ringbuf.read_idx == ringbuf.process_idx) {
         tud_audio_write(silence_buf, AUDIO_FRAME_BYTES);
+        perf_count(PERF_COUNTER_TX_UNDERRUN);
     } else {
-        uint8_t *output = tx_ringbuf.buffer[tx_ringbuf.read_idx];
+        uint8_t *output = ringbuf.buffer[ringbuf.read_idx];
+
+        uint32_t delay_us = time_us_32() - ringbuf.arrival_us[ringbuf.read_idx];
 
         tud_audio_write(output, AUDIO_FRAME_BYTES);
-        tx_ringbuf.read_idx = (tx_ringbuf.read_idx + 1) % RINGBUF_FRAMES;
+        perf_record(PERF_STAT_OUTPUT_US, delay_us);
+        track_ring_delay(delay_us);
+        ringbuf.read_idx = (ringbuf.read_idx + 1) % RINGBUF_FRAMES;
+    }
+    return true;
+}
+
+// Called for every SET_INTERFACE, before the endpoints of the new alt setting are opened.
+bool tud_audio_set_itf_close_EP_cb(uint8_t rhport, tusb_control_request_t const *p_request) {
+    (void)rhport;
+    if (tu_u16_low(tu_le16toh(p_request->wIndex)) == ITF_NUM_AUDIO_STREAMING_SPK)
+        rx_stream_open = false;
+    return true;
+}
+
+// A newly opened OUT stream starts from an empty ring: frames left over from the previous
+// stream would otherwise play first and stay in the ring as added latency. A stamp left from
+// before the stream would date its first frame too early.
+bool tud_audio_set_itf_cb(uint8_t rhport, tusb_control_request_t const *p_request) {
+    (void)rhport;
+    uint8_t const itf = tu_u16_low(tu_le16toh(p_request->wIndex));
+    uint8_t const alt = tu_u16_low(tu_le16toh(p_request->wValue));
+
+    if (ITF_NUM_AUDIO_STREAMING_SPK == itf && alt != 0) {
+        led_set_blink_interval(BLINK_STREAMING);
+        ringbuf.read_idx = ringbuf.process_idx = ringbuf.write_idx = 0;
+        ring_delay_us = ring_delay_window_max = ring_delay_window_ticks = 0;
+        rx_irq_stamped = false;
+        rx_done_sof = usb_hw->sof_rd & USB_SOF_RD_BITS;
+        rx_stream_open = true;
     }
     return true;
 }
 
 int main(void) {
-    set_sys_clock_khz(240000, true);
+    fx_init();
+    clock_governor_init();
     stdio_init_all();
 
+    // One record is checked in the common case, so this does not hold up enumeration.
+    fx_params_t params;
+    preset_init();
+    if (preset_load(&params))
+        fx_set_params(&params);
+
     board_init();
     tusb_rhport_init_t dev_init = {.role = TUSB_ROLE_DEVICE, .speed = TUSB_SPEED_AUTO};
     tusb_init(BOARD_TUD_RHPORT, &dev_init);
     board_init_after_tusb();
 
-    fx_init();
+    perf_init();
+    dsp_selftest();
+    add_repeating_timer_ms(-CONTROL_TICK_MS, control_timer_cb, NULL, &control_timer);
 
     while (1) {
         tud_task();
+#ifdef FX_SCHED_POLLING
         audio_task();
-        led_task();
+#endif
+        if (control_pending) {
+            control_pending = false;
+            control_task();
+            led_task();
+            meter_task();
+            latency_task();
+            preset_command_task();
+            perf_report();
+        }
+        // No frame is in flight here: a safe point to retune the clock.
+        clock_governor_update();
+#ifndef FX_SCHED_POLLING
+        wait_for_event();
+#endif
     }
 }
@@ -0,0 +1,63 @@
+/*
+ * Copyright 2025, Hiroyuki OYAMA
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+#include "meter.h"
+
+#include <math.h>
+#include <string.h>
+
+static dsp_level_t frame_levels[AUDIO_NUM_CHANNELS];
+static dsp_level_t window_levels[AUDIO_NUM_CHANNELS];
+static uint32_t window_frames = 0;
+static uint16_t sequence = 0;
+
+static meter_report_t pending_report;
+static bool report_ready = false;
+
+void meter_begin_frame(void) { memset(frame_levels, 0, sizeof(frame_levels)); }
+
+// Accumulators for the frame being processed, one per channel. Whatever pass writes the final
+// output samples adds them here, so metering never costs a traversal of its own.
+dsp_level_t *meter_levels(void) { return frame_levels; }
+
+// For frames that no effect pass touches (bypass), metering is the only traversal.
+void meter_scan(const uint8_t *frame) {
+    const int32_t *samples = (const int32_t *)frame;
+    for (int i = 0; i < AUDIO_FRAME_SAMPLES; i++) {
+        dsp_level_add(&frame_levels[0], samples[i * AUDIO_NUM_CHANNELS + 0]);
+        dsp_level_add(&frame_levels[1], samples[i * AUDIO_NUM_CHANNELS + 1]);
+    }
+}
+
+void meter_end_frame(void) {
+    for (int ch = 0; ch < AUDIO_NUM_CHANNELS; ch++) {
+        if (frame_levels[ch].peak > window_levels[ch].peak)
+            window_levels[ch].peak = frame_levels[ch].peak;
+        window_levels[ch].sum_sq += frame_levels[ch].sum_sq;
+    }
+    if (++window_frames < METER_REPORT_FRAMES)
+        return;
+
+    // Silent frames add nothing but still count towards the mean.
+    const float samples = (float)(METER_REPORT_FRAMES * AUDIO_FRAME_SAMPLES);
+    pending_report.version = METER_REPORT_VERSION;
+    pending_report.sequence = sequence++;
+    for (int ch = 0; ch < AUDIO_NUM_CHANNELS; ch++) {
+        pending_report.peak[ch] = window_levels[ch].peak;
+        pending_report.rms[ch] = (uint32_t)(sqrtf((float)window_levels[ch].sum_sq / samples) * 128);
+    }
+    report_ready = true;
+
+    memset(window_levels, 0, sizeof(window_levels));
+    window_frames = 0;
+}
+
+bool meter_take_report(meter_report_t *report) {
+    if (!report_ready)
+        return false;
+    *report = pending_report;
+    report_ready = false;
+    return true;
+}
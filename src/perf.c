@@ -0,0 +1,125 @@
+/*
+ * Copyright 2025, Hiroyuki OYAMA
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+#include "perf.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+
+#include "hardware/clocks.h"
+#include "hardware/structs/systick.h"
+#include "hardware/uart.h"
+#include "pico/stdlib.h"
+
+#define PERF_REPORT_INTERVAL_US 1000000
+#define PERF_REPORT_SIZE 512
+#define SYSTICK_MASK 0x00ffffff
+
+static const char *const stat_names[PERF_NUM_STATS] = {
+    "dispatch_us",
+    "output_us",
+    "dsp_cycles",
+    "fx_cycles",
+};
+
+static const char *const counter_names[PERF_NUM_COUNTERS] = {
+    "rx_dropped",
+    "tx_underrun",
+    "fx_bypassed",
+    "fx_silent",
+};
+
+static perf_stat_t stats[PERF_NUM_STATS];
+static uint32_t counters[PERF_NUM_COUNTERS];
+static uint32_t last_report_us = 0;
+static uint32_t last_skipped = 0;
+static uint32_t fx_cycles_avg = 0;
+static char report[PERF_REPORT_SIZE];
+static size_t report_len = 0;
+static size_t report_pos = 0;
+
+static void perf_stat_reset(perf_stat_t *stat) {
+    stat->count = 0;
+    stat->min = UINT32_MAX;
+    stat->max = 0;
+    stat->sum = 0;
+}
+
+void perf_init(void) {
+    // SysTick free-runs on the processor clock as a 24-bit down counter, giving cycle
+    // resolution on both the Cortex-M0+ and the Cortex-M33, which lack a common DWT.
+    systick_hw->rvr = SYSTICK_MASK;
+    systick_hw->cvr = 0;
+    systick_hw->csr = 0x5;  // ENABLE | CLKSOURCE(processor)
+
+    for (int i = 0; i < PERF_NUM_STATS; i++)
+        perf_stat_reset(&stats[i]);
+    last_report_us = time_us_32();
+}
+
+uint32_t perf_cycles(void) { return systick_hw->cvr; }
+
+uint32_t perf_cycles_since(uint32_t start) { return (start - systick_hw->cvr) & SYSTICK_MASK; }
+
+void perf_record(perf_stat_id_t id, uint32_t value) {
+    perf_stat_t *stat = &stats[id];
+    stat->count++;
+    stat->sum += value;
+    if (value < stat->min)
+        stat->min = value;
+    if (value > stat->max)
+        stat->max = value;
+}
+
+void perf_count(perf_counter_id_t id) { counters[id]++; }
+
+static void report_append(const char *format, ...) {
+    va_list args;
+    va_start(args, format);
+    int n = vsnprintf(report + report_len, sizeof(report) - report_len, format, args);
+    va_end(args);
+    if (n > 0)
+        report_len += (size_t)n < sizeof(report) - report_len ? (size_t)n
+                                                              : sizeof(report) - report_len - 1;
+}
+
+static void report_format(void) {
+    report_len = report_pos = 0;
+    report_append("sys_khz: %lu\r\n", (unsigned long)(clock_get_hz(clk_sys) / 1000));
+
+    // Frames skipped by bypass or silence detection, priced at what the effect costs when it runs
+    uint32_t skipped = counters[PERF_COUNTER_FX_BYPASSED] + counters[PERF_COUNTER_FX_SILENT];
+    perf_stat_t *fx = &stats[PERF_STAT_FX_CYCLES];
+    if (fx->count)
+        fx_cycles_avg = (uint32_t)(fx->sum / fx->count);
+    report_append("cycles_saved: %lu\r\n",
+                  (unsigned long)((skipped - last_skipped) * fx_cycles_avg));
+    last_skipped = skipped;
+
+    for (int i = 0; i < PERF_NUM_STATS; i++) {
+        perf_stat_t *stat = &stats[i];
+        if (stat->count == 0)
+            continue;
+        report_append("%s: min=%lu avg=%lu max=%lu jitter=%lu\r\n", stat_names[i],
+                      (unsigned long)stat->min, (unsigned long)(stat->sum / stat->count),
+                      (unsigned long)stat->max, (unsigned long)(stat->max - stat->min));
+        perf_stat_reset(stat);
+    }
+    for (int i = 0; i < PERF_NUM_COUNTERS; i++)
+        report_append("%s: %lu\r\n", counter_names[i], (unsigned long)counters[i]);
+}
+
+// A blocking printf of the whole report would hold the main loop for ~25 ms at 115200 baud,
+// long enough for the ring to run dry. The report is formatted in RAM instead, and each call
+// only moves what fits in the UART TX FIFO.
+void perf_report(void) {
+    uint32_t now = time_us_32();
+    if (report_pos == report_len && now - last_report_us >= PERF_REPORT_INTERVAL_US) {
+        last_report_us = now;
+        report_format();
+    }
+    while (report_pos < report_len && uart_is_writable(uart_default))
+        uart_putc_raw(uart_default, report[report_pos++]);
+}
@@ -0,0 +1,134 @@
+/*
+ * Copyright 2025, Hiroyuki OYAMA
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+#include "preset.h"
+
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "hardware/flash.h"
+#include "hardware/sync.h"
+
+// The log lives in the last flash sector, well past the program image. Records are appended
+// until the sector is full, so each slot is programmed once per erase and an erase happens
+// only every PRESET_SLOTS saves.
+#define PRESET_FLASH_OFFSET (PICO_FLASH_SIZE_BYTES - FLASH_SECTOR_SIZE)
+#define PRESET_MAGIC 0x46585052u  // "RPXF"
+#define PRESET_ERASED 0xffffffffu
+
+typedef struct {
+    uint32_t magic;
+    uint32_t fx_id;     // hash of fx_name(), so another effect's preset is never applied
+    uint32_t sequence;  // saves since the log was created
+    fx_params_t params;
+    uint32_t crc;
+} preset_record_t;
+
+_Static_assert(FLASH_PAGE_SIZE % sizeof(preset_record_t) == 0, "records must tile a page");
+
+#define PRESET_SLOTS (FLASH_SECTOR_SIZE / sizeof(preset_record_t))
+
+static const preset_record_t *const preset_log =
+    (const preset_record_t *)(XIP_BASE + PRESET_FLASH_OFFSET);
+
+static uint32_t fx_id = 0;
+static uint32_t next_slot = 0;
+static uint32_t next_sequence = 0;
+static const preset_record_t *latest = NULL;
+static fx_params_t pending_params;
+static bool pending = false;
+
+static uint32_t fnv1a(const void *data, size_t len, uint32_t hash) {
+    const uint8_t *p = data;
+    for (size_t i = 0; i < len; i++)
+        hash = (hash ^ p[i]) * 16777619u;
+    return hash;
+}
+
+static uint32_t record_crc(const preset_record_t *record) {
+    return fnv1a(record, offsetof(preset_record_t, crc), 2166136261u);
+}
+
+static bool record_valid(const preset_record_t *record) {
+    return record->magic == PRESET_MAGIC && record->fx_id == fx_id &&
+           record->crc == record_crc(record);
+}
+
+void preset_init(void) {
+    const char *name = fx_name();
+    fx_id = fnv1a(name, strlen(name), 2166136261u);
+
+    // Slots fill in order, so the first erased one ends the log and the newest record is the
+    // last valid one before it. A record torn by a power cut fails its CRC and is skipped.
+    next_slot = PRESET_SLOTS;
+    for (uint32_t i = 0; i < PRESET_SLOTS; i++) {
+        if (preset_log[i].magic == PRESET_ERASED) {
+            next_slot = i;
+            break;
+        }
+    }
+    latest = NULL;
+    next_sequence = 0;
+    for (uint32_t i = next_slot; i-- > 0;) {
+        if (record_valid(&preset_log[i])) {
+            latest = &preset_log[i];
+            next_sequence = latest->sequence + 1;
+            break;
+        }
+    }
+}
+
+bool preset_load(fx_params_t *params) {
+    if (latest == NULL)
+        return false;
+    memcpy(params, &latest->params, sizeof(*params));
+    printf("preset: loaded save #%lu from slot %u\n", (unsigned long)latest->sequence,
+           (unsigned)(latest - preset_log));
+    return true;
+}
+
+void preset_save(const fx_params_t *params) {
+    memcpy(&pending_params, params, sizeof(pending_params));
+    pending = true;
+}
+
+void preset_task(bool audio_idle) {
+    if (!pending || !audio_idle)
+        return;
+
+    preset_record_t record = {
+        .magic = PRESET_MAGIC,
+        .fx_id = fx_id,
+        .sequence = next_sequence,
+        .params = pending_params,
+    };
+    record.crc = record_crc(&record);
+
+    // A full log is erased and restarted with this record. Presets of other effects do not
+    // survive that; only the linked effect is ever loaded.
+    bool erase = next_slot >= PRESET_SLOTS;
+    if (erase)
+        next_slot = 0;
+
+    // Programming only clears bits, so 0xff around the record leaves its neighbours intact.
+    static uint8_t page[FLASH_PAGE_SIZE];
+    uint32_t offset = next_slot * sizeof(preset_record_t);
+    memset(page, 0xff, sizeof(page));
+    memcpy(&page[offset % FLASH_PAGE_SIZE], &record, sizeof(record));
+
+    // Nothing may run from flash meanwhile, interrupt handlers included.
+    uint32_t flags = save_and_disable_interrupts();
+    if (erase)
+        flash_range_erase(PRESET_FLASH_OFFSET, FLASH_SECTOR_SIZE);
+    flash_range_program(PRESET_FLASH_OFFSET + offset - offset % FLASH_PAGE_SIZE, page,
+                        FLASH_PAGE_SIZE);
+    restore_interrupts(flags);
+
+    latest = &preset_log[next_slot];
+    next_slot++;
+    next_sequence++;
+    pending = false;
+}
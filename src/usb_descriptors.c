@@ -14,17 +14,18 @@
 #define USB_PID                                                                            \
     (0x4000 | _PID_MAP(CDC, 0) | _PID_MAP(MSC, 1) | _PID_MAP(HID, 2) | _PID_MAP(MIDI, 3) | \
      _PID_MAP(AUDIO, 4) | _PID_MAP(VENDOR, 5))
-#define CONFIG_TOTAL_LEN (TUD_CONFIG_DESC_LEN + CFG_TUD_AUDIO * TUD_AUDIO_INTERFACE_STEREO_DESC_LEN)
-
-#define EPNUM_AUDIO_IN 0x01
-#define EPNUM_AUDIO_OUT 0x01
-#define EPNUM_AUDIO_INT 0x02
+#define CONFIG_TOTAL_LEN                                                          \
+    (TUD_CONFIG_DESC_LEN + CFG_TUD_AUDIO * TUD_AUDIO_INTERFACE_STEREO_DESC_LEN + \
+     CFG_TUD_VENDOR * TUD_VENDOR_DESC_LEN)
 
 enum {
     STRID_LANGID = 0,
     STRID_MANUFACTURER,
     STRID_PRODUCT,
     STRID_SERIAL,
+    STRID_AUDIO_OUTPUT,
+    STRID_AUDIO_INPUT,
+    STRID_VENDOR,
 };
 
 tusb_desc_device_t const desc_device = {.bLength = sizeof(tusb_desc_device_t),
@@ -50,7 +51,10 @@ uint8_t const desc_configuration[] = {
     TUD_CONFIG_DESCRIPTOR(1, ITF_NUM_TOTAL, 0, CONFIG_TOTAL_LEN, 0x00, 100),
     // Interface number, string index, EP Out & EP In address, EP size
     TUD_AUDIO_INTERFACE_STEREO_DESCRIPTOR(2, EPNUM_AUDIO_OUT, EPNUM_AUDIO_IN | 0x80,
-                                          EPNUM_AUDIO_INT | 0x80)};
+                                          EPNUM_AUDIO_INT | 0x80),
+    // Interface number, string index, EP Out & EP In address, EP size
+    TUD_VENDOR_DESCRIPTOR(ITF_NUM_VENDOR, STRID_VENDOR, EPNUM_VENDOR_OUT, EPNUM_VENDOR_IN | 0x80,
+                          CFG_TUD_VENDOR_EPSIZE)};
 
 char const *string_desc_arr[] = {
     (const char[]){0x09, 0x04},  // 0: is supported language is English (0x0409)
@@ -59,6 +63,7 @@ char const *string_desc_arr[] = {
     NULL,                        // 3: Serials will use unique ID if possible
     "FX Output",                 // 4: Audio Interface
     "FX Input",                  // 5: Audio Interface
+    "FX Meter",                  // 6: Vendor Interface
 };
 
 static uint16_t _desc_str[32 + 1];
@@ -66,12 +71,36 @@ static uint16_t _desc_str[32 + 1];
 static const uint32_t supported_sample_rates[] = {44100, 48000};
 static uint32_t current_sample_rate = 48000;
 #define N_SAMPLE_RATES TU_ARRAY_SIZE(supported_sample_rates)
-static uint8_t current_resolution = 24;
+static uint32_t current_latency_ns = 0;
+static bool latency_notify_pending = false;
 
 uint32_t usb_current_sample_rate(void) {
     return current_sample_rate;
 }
 
+// The whole insert delay is attributed to the input terminal feeding the IN stream; the other
+// terminals report zero so a host summing along the path counts it once. The change notification
+// stays pending until the interrupt endpoint accepts it.
+void usb_set_latency_ns(uint32_t latency_ns) {
+    if (latency_ns != current_latency_ns) {
+        current_latency_ns = latency_ns;
+        latency_notify_pending = true;
+    }
+    if (!latency_notify_pending || !tud_audio_mounted())
+        return;
+
+    audio_interrupt_data_t data = {
+        .bInfo = 0,
+        .bAttribute = AUDIO_CS_REQ_CUR,
+        .wValue_cn_or_mcn = 0,
+        .wValue_cs = AUDIO_TE_CTRL_LATENCY,
+        .wIndex_ep_or_int = ITF_NUM_AUDIO_CONTROL,
+        .wIndex_entity_id = UAC2_ENTITY_MIC_INPUT_TERMINAL,
+    };
+    if (tud_audio_int_write(&data))
+        latency_notify_pending = false;
+}
+
 uint8_t const *tud_descriptor_device_cb(void) { return (uint8_t const *)&desc_device; }
 
 uint8_t const *tud_descriptor_configuration_cb(uint8_t index) {
@@ -184,12 +213,29 @@ static bool tud_audio_clock_set_request(uint8_t rhport, audio_control_request_t
     }
 }
 
+// Latency in ns, enabled for every terminal by the latency bit in the AC header.
+static bool tud_audio_terminal_get_request(uint8_t rhport, audio_control_request_t const *request) {
+    if (request->bControlSelector != AUDIO_TE_CTRL_LATENCY || request->bRequest != AUDIO_CS_REQ_CUR)
+        return false;
+
+    uint32_t latency_ns =
+        (request->bEntityID == UAC2_ENTITY_MIC_INPUT_TERMINAL) ? current_latency_ns : 0;
+    audio_control_cur_4_t cur = {(int32_t)tu_htole32(latency_ns)};
+    return tud_audio_buffer_and_schedule_control_xfer(
+        rhport, (tusb_control_request_t const *)request, &cur, sizeof(cur));
+}
+
 // Invoked when audio class specific get request received for an entity
 bool tud_audio_get_req_entity_cb(uint8_t rhport, tusb_control_request_t const *p_request) {
     audio_control_request_t const *request = (audio_control_request_t const *)p_request;
 
     if (request->bEntityID == UAC2_ENTITY_CLOCK)
         return tud_audio_clock_get_request(rhport, request);
+    if (request->bEntityID == UAC2_ENTITY_SPK_INPUT_TERMINAL ||
+        request->bEntityID == UAC2_ENTITY_SPK_OUTPUT_TERMINAL ||
+        request->bEntityID == UAC2_ENTITY_MIC_INPUT_TERMINAL ||
+        request->bEntityID == UAC2_ENTITY_MIC_OUTPUT_TERMINAL)
+        return tud_audio_terminal_get_request(rhport, request);
 
     return false;
 }
@@ -204,17 +250,3 @@ bool tud_audio_set_req_entity_cb(uint8_t rhport, tusb_control_request_t const *p
 
     return false;
 }
-
-bool tud_audio_set_itf_cb(uint8_t rhport, tusb_control_request_t const *p_request) {
-    (void)rhport;
-    uint8_t const itf = tu_u16_low(tu_le16toh(p_request->wIndex));
-    uint8_t const alt = tu_u16_low(tu_le16toh(p_request->wValue));
-
-    if (ITF_NUM_AUDIO_STREAMING_SPK == itf && alt != 0)
-        led_set_blink_interval(BLINK_STREAMING);
-
-    if (alt != 0) {
-        current_resolution = CFG_TUD_AUDIO_FUNC_1_FORMAT_1_RESOLUTION_RX;
-    }
-    return true;
-}
@@ -0,0 +1,197 @@
+/*
+ * Copyright 2025, Hiroyuki OYAMA
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+// Host check of the selected DSP kernel variant against the portable reference. It runs
+// dsp_selftest() as the device does at boot, then sweeps each kernel over the settings the
+// effects actually use. The largest difference in 24-bit LSBs must stay within the tolerances
+// in dsp.h. The exit status is non-zero if any kernel is out of tolerance.
+#include <math.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "dsp.h"
+#include "ringbuffer.h"
+
+#define TEST_FRAMES 200
+#define TEST_RING_FRAMES (4 * AUDIO_FRAME_SAMPLES)
+#define TEST_SAMPLES (AUDIO_FRAME_SAMPLES * AUDIO_NUM_CHANNELS)
+
+static int32_t ref_buf[TEST_SAMPLES];
+static int32_t dut_buf[TEST_SAMPLES];
+static int32_t ring[TEST_RING_FRAMES * AUDIO_NUM_CHANNELS];
+static uint32_t seed = 1;
+
+// dsp_selftest() times the kernels with these on the device; only the errors matter here.
+uint32_t perf_cycles(void) { return 0; }
+uint32_t perf_cycles_since(uint32_t start) { return 0 - start; }
+
+// Noise, or a 997 Hz sine when `tone` is set, peaking at 6 dB * `shift` below full scale;
+// 24-bit in a 32-bit slot.
+static void fill(int32_t *buf, size_t n, bool tone, uint32_t offset, int shift) {
+    for (size_t i = 0; i < n; i++) {
+        if (tone) {
+            double phase = 2 * M_PI * 997.0 * (double)(offset + i / AUDIO_NUM_CHANNELS) /
+                           AUDIO_SAMPLE_RATE;
+            buf[i] = (int32_t)(sin(phase) * (double)(INT32_MAX >> shift)) & ~0xff;
+        } else {
+            seed = seed * 1664525u + 1013904223u;
+            buf[i] = ((int32_t)seed >> shift) & ~0xff;
+        }
+    }
+}
+
+static uint32_t peak_of(const int32_t *buf, size_t n) {
+    uint32_t peak = 0;
+    for (size_t i = 0; i < n; i++) {
+        uint32_t mag = (uint32_t)(buf[i] < 0 ? ~buf[i] : buf[i]);
+        if (mag > peak)
+            peak = mag;
+    }
+    return peak;
+}
+
+static uint32_t max_error_lsb(const int32_t *a, const int32_t *b, size_t n) {
+    uint32_t max = 0;
+    for (size_t i = 0; i < n; i++) {
+        int64_t diff = ((int64_t)a[i] - b[i]) >> 8;
+        uint32_t err = (uint32_t)(diff < 0 ? -diff : diff);
+        if (err > max)
+            max = err;
+    }
+    return max;
+}
+
+static bool report(const char *kernel, uint32_t err, uint32_t tolerance) {
+    bool ok = err <= tolerance;
+    printf("%-10s %-8s max error %3u LSB, tolerance %3u LSB  %s\n", kernel, dsp_variant(), err,
+           tolerance, ok ? "ok" : "FAIL");
+    return ok;
+}
+
+// One filter setting over TEST_FRAMES frames of alternating noise and tone. A cutoff of 0
+// sweeps from fs/2 down to 500 Hz, recomputing the coefficients every frame as fx_lpf.c does.
+// Returns UINT32_MAX if the reference output comes within 6 dB of full scale.
+static uint32_t run_biquad(size_t n_stages, float cutoff, float q, int shift) {
+    dsp_biquad_t ref_bq[2], dut_bq[2];
+    uint32_t err = 0;
+
+    for (int f = 0; f < TEST_FRAMES; f++) {
+        float fc = cutoff ? cutoff : 24000.0f * powf(500.0f / 24000.0f, f / (TEST_FRAMES - 1.0f));
+        for (size_t s = 0; s < n_stages; s++) {
+            if (f == 0 || cutoff == 0.0f) {
+                dsp_biquad_lowpass(&ref_bq[s], 48000.0f, fc, q);
+                dsp_biquad_lowpass(&dut_bq[s], 48000.0f, fc, q);
+            }
+            if (f == 0) {
+                dsp_biquad_reset(&ref_bq[s]);
+                dsp_biquad_reset(&dut_bq[s]);
+            }
+        }
+        fill(ref_buf, TEST_SAMPLES, f & 1, f * AUDIO_FRAME_SAMPLES, shift);
+        memcpy(dut_buf, ref_buf, sizeof(dut_buf));
+        for (int ch = 0; ch < AUDIO_NUM_CHANNELS; ch++) {
+            dsp_ref_biquad_cascade(ref_buf + ch, AUDIO_FRAME_SAMPLES, AUDIO_NUM_CHANNELS, ref_bq,
+                                   n_stages, NULL);
+            dsp_biquad_cascade(dut_buf + ch, AUDIO_FRAME_SAMPLES, AUDIO_NUM_CHANNELS, dut_bq,
+                               n_stages, NULL);
+        }
+        if (peak_of(ref_buf, TEST_SAMPLES) >= (1u << 30))
+            return UINT32_MAX;
+        uint32_t e = max_error_lsb(ref_buf, dut_buf, TEST_SAMPLES);
+        if (e > err)
+            err = e;
+    }
+    return err;
+}
+
+// The LPF's default range: cutoffs from 500 Hz up to fully open at fs/2, Q up to its default
+// of 6, one stage and the pair fx_lpf.c runs. Each setting is driven as loud as it goes
+// without the reference overloading, from -6 dBFS down in 6 dB steps; an overloaded frame
+// would make the float to int conversion undefined. Below a few hundred hertz the poles sit so
+// close to 1 that single precision cannot hold them, and any two evaluation orders diverge.
+static uint32_t test_biquad(void) {
+    static const float cutoffs[] = {0.0f, 500.0f, 1000.0f, 2000.0f, 8000.0f, 20000.0f, 24000.0f};
+    static const float qs[] = {0.5f, 0.707f, 2.0f, 6.0f};
+    uint32_t err = 0;
+
+    for (size_t n_stages = 1; n_stages <= 2; n_stages++) {
+        for (size_t c = 0; c < sizeof(cutoffs) / sizeof(cutoffs[0]); c++) {
+            for (size_t q = 0; q < sizeof(qs) / sizeof(qs[0]); q++) {
+                uint32_t e = UINT32_MAX;
+                for (int shift = 1; e == UINT32_MAX && shift < 16; shift++)
+                    e = run_biquad(n_stages, cutoffs[c], qs[q], shift);
+                if (e > err)
+                    err = e;
+            }
+        }
+    }
+    return err;
+}
+
+// Fixed speeds, including a stopped tape, and a TapeStop-like decay that crosses every
+// fractional position and wraps the ring.
+static uint32_t test_resample(void) {
+    static const float speeds[] = {0.0f, 0.001f, 0.37f, 0.5f, 0.999f, 1.0f};
+    uint32_t err = 0;
+
+    fill(ring, TEST_RING_FRAMES * AUDIO_NUM_CHANNELS, false, 0, 1);
+    for (size_t sp = 0; sp <= sizeof(speeds) / sizeof(speeds[0]); sp++) {
+        bool decay = sp == sizeof(speeds) / sizeof(speeds[0]);
+        float speed = decay ? 1.0f : speeds[sp];
+        float ref_pos = 17.25f, dut_pos = 17.25f;
+        for (int f = 0; f < TEST_FRAMES; f++) {
+            ref_pos = dsp_ref_resample(ref_buf, ring, TEST_RING_FRAMES, ref_pos, speed,
+                                       AUDIO_FRAME_SAMPLES);
+            dut_pos = dsp_resample(dut_buf, ring, TEST_RING_FRAMES, dut_pos, speed,
+                                   AUDIO_FRAME_SAMPLES);
+            uint32_t e = max_error_lsb(ref_buf, dut_buf, TEST_SAMPLES);
+            if (e > err)
+                err = e;
+            if (decay)
+                speed *= 0.98f;
+        }
+    }
+    return err;
+}
+
+// Ramps in both directions at the pipeline's and the effects' fade rates, plus fixed gains
+// at and next to the end points.
+static uint32_t test_crossfade(void) {
+    static const int32_t steps[] = {1, 170, 1024, -170, -1024};
+    static const int32_t gains[] = {0, 1, 16384, DSP_GAIN_UNITY - 1, DSP_GAIN_UNITY};
+    const int32_t *from = &ring[0];
+    const int32_t *to = &ring[TEST_SAMPLES];
+    const size_t n_steps = sizeof(steps) / sizeof(steps[0]);
+    const size_t n_gains = sizeof(gains) / sizeof(gains[0]);
+    uint32_t err = 0;
+
+    fill(ring, TEST_RING_FRAMES * AUDIO_NUM_CHANNELS, false, 0, 1);
+    for (size_t i = 0; i < n_steps + n_gains; i++) {
+        bool ramp = i < n_steps;
+        int32_t step = ramp ? steps[i] : 0;
+        int32_t start = ramp ? (step > 0 ? 0 : DSP_GAIN_UNITY) : gains[i - n_steps];
+        int32_t ref_gain = start, dut_gain = start;
+        for (int f = 0; f < TEST_FRAMES; f++) {
+            ref_gain = dsp_ref_crossfade(ref_buf, from, to, AUDIO_FRAME_SAMPLES, ref_gain, step,
+                                         NULL);
+            dut_gain = dsp_crossfade(dut_buf, from, to, AUDIO_FRAME_SAMPLES, dut_gain, step, NULL);
+            uint32_t e = max_error_lsb(ref_buf, dut_buf, TEST_SAMPLES);
+            if (e > err)
+                err = e;
+            if (ref_gain != dut_gain)
+                err = UINT32_MAX;
+        }
+    }
+    return err;
+}
+
+int main(void) {
+    bool ok = dsp_selftest();
+    ok &= report("biquad", test_biquad(), DSP_BIQUAD_SWEEP_TOLERANCE_LSB);
+    ok &= report("resample", test_resample(), DSP_RESAMPLE_TOLERANCE_LSB);
+    ok &= report("crossfade", test_crossfade(), DSP_CROSSFADE_TOLERANCE_LSB);
+    return ok ? 0 : 1;
+}
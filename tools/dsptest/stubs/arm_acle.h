@@ -0,0 +1,25 @@
+/*
+ * Copyright 2025, Hiroyuki OYAMA
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+// Bit-exact C versions of the Cortex-M33 DSP intrinsics used by src/dsp.c, so the m33 kernels
+// can be run on the host.
+#pragma once
+
+#include <stdint.h>
+
+// SMULWB: top 32 bits of the 48-bit product of a and the signed bottom half of b
+static inline int32_t __smulwb(int32_t a, int32_t b) {
+    return (int32_t)(((int64_t)a * (int16_t)b) >> 16);
+}
+
+// QADD: signed saturating add
+static inline int32_t __qadd(int32_t a, int32_t b) {
+    int64_t sum = (int64_t)a + b;
+    if (sum > INT32_MAX)
+        return INT32_MAX;
+    if (sum < INT32_MIN)
+        return INT32_MIN;
+    return (int32_t)sum;
+}
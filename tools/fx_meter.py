@@ -0,0 +1,90 @@
+#!/usr/bin/env python3
+#
+# Copyright 2025, Hiroyuki OYAMA
+#
+# SPDX-License-Identifier: BSD-3-Clause
+#
+"""Print the peak/RMS meters and effect state streamed by pico-usb-audio-fx.
+
+The device sends a meter_report_t (include/meter.h) every 50 ms on the bulk IN
+endpoint of its vendor interface. Requires pyusb (pip install pyusb).
+"""
+import argparse
+import math
+import struct
+import sys
+
+import usb.core
+import usb.util
+
+VID = 0xCAFE
+PID = 0x4030  # 0x4000 | AUDIO << 4 | VENDOR << 5
+REPORT = struct.Struct("<BBH2I2II")
+REPORT_VERSION = 1
+FLAG_FX_ACTIVE = 0x01
+FULL_SCALE = float(0x7FFFFF)
+BAR_WIDTH = 30
+FLOOR_DB = -60.0
+
+
+def dbfs(value):
+    return 20.0 * math.log10(value / FULL_SCALE) if value > 0 else float("-inf")
+
+
+def bar(db):
+    filled = 0 if db == float("-inf") else int((1.0 - max(db, FLOOR_DB) / FLOOR_DB) * BAR_WIDTH)
+    return "#" * filled + "." * (BAR_WIDTH - filled)
+
+
+def find_vendor_endpoint(dev):
+    for intf in dev.get_active_configuration():
+        if intf.bInterfaceClass != 0xFF:
+            continue
+        for ep in intf:
+            if usb.util.endpoint_direction(ep.bEndpointAddress) == usb.util.ENDPOINT_IN:
+                return intf, ep
+    return None, None
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__)
+    parser.add_argument("--raw", action="store_true", help="print raw report fields")
+    args = parser.parse_args()
+
+    dev = usb.core.find(idVendor=VID, idProduct=PID)
+    if dev is None:
+        sys.exit("pico-usb-audio-fx not found")
+    intf, ep = find_vendor_endpoint(dev)
+    if ep is None:
+        sys.exit("vendor meter interface not found")
+    usb.util.claim_interface(dev, intf.bInterfaceNumber)
+
+    last_sequence = None
+    while True:
+        try:
+            data = bytes(ep.read(REPORT.size, timeout=1000))
+        except usb.core.USBTimeoutError:
+            continue
+        if len(data) != REPORT.size:
+            continue
+        version, flags, sequence, peak_l, peak_r, rms_l, rms_r, status = REPORT.unpack(data)
+        if version != REPORT_VERSION:
+            sys.exit(f"unsupported report version {version}")
+
+        lost = 0 if last_sequence is None else (sequence - last_sequence - 1) & 0xFFFF
+        last_sequence = sequence
+        if args.raw:
+            print(version, flags, sequence, peak_l, peak_r, rms_l, rms_r, status)
+            continue
+
+        state = "FX " if flags & FLAG_FX_ACTIVE else "byp"
+        line = f"{state} status={status:<8}"
+        for name, peak, rms in (("L", peak_l, rms_l), ("R", peak_r, rms_r)):
+            line += f" {name} {bar(dbfs(rms))} rms {dbfs(rms):6.1f} peak {dbfs(peak):6.1f}"
+        if lost:
+            line += f" (lost {lost})"
+        print(line, flush=True)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,84 @@
+#!/usr/bin/env python3
+#
+# Copyright 2025, Hiroyuki OYAMA
+#
+# SPDX-License-Identifier: BSD-3-Clause
+#
+"""Send effect parameters to pico-usb-audio-fx and optionally save them.
+
+The parameters are sent as a preset_command_t (include/preset.h) on the bulk
+OUT endpoint of the vendor interface. They apply at once; a saved preset is
+written to flash once the host stops streaming audio and is loaded at boot.
+Their meaning depends on the effect, see fx_get_params() in its source file.
+Parameters left out keep their current values, read from the device with a
+vendor control request; without any, the current values are printed.
+Requires pyusb (pip install pyusb).
+"""
+import argparse
+import struct
+import sys
+
+import usb.core
+import usb.util
+
+VID = 0xCAFE
+PID = 0x4030  # 0x4000 | AUDIO << 4 | VENDOR << 5
+NUM_PARAMS = 4
+COMMAND = struct.Struct(f"<BBH{NUM_PARAMS}i")
+COMMAND_VERSION = 1
+FLAG_SAVE = 0x01
+REQUEST_GET = 0x01
+
+
+def find_vendor_endpoint(dev):
+    for intf in dev.get_active_configuration():
+        if intf.bInterfaceClass != 0xFF:
+            continue
+        for ep in intf:
+            if usb.util.endpoint_direction(ep.bEndpointAddress) == usb.util.ENDPOINT_OUT:
+                return intf, ep
+    return None, None
+
+
+def read_params(dev, intf):
+    request_type = usb.util.build_request_type(
+        usb.util.CTRL_IN, usb.util.CTRL_TYPE_VENDOR, usb.util.CTRL_RECIPIENT_INTERFACE)
+    data = bytes(dev.ctrl_transfer(request_type, REQUEST_GET, 0, intf.bInterfaceNumber,
+                                   COMMAND.size, timeout=1000))
+    if len(data) != COMMAND.size:
+        sys.exit("short reply to the parameter request")
+    version, _, _, *values = COMMAND.unpack(data)
+    if version != COMMAND_VERSION:
+        sys.exit(f"unsupported command version {version}")
+    return values
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__)
+    parser.add_argument("values", type=int, nargs="*",
+                        help=f"up to {NUM_PARAMS} parameters; the rest keep their current values")
+    parser.add_argument("--save", action="store_true", help="persist the parameters in flash")
+    args = parser.parse_args()
+    if len(args.values) > NUM_PARAMS:
+        sys.exit(f"at most {NUM_PARAMS} parameters")
+
+    dev = usb.core.find(idVendor=VID, idProduct=PID)
+    if dev is None:
+        sys.exit("pico-usb-audio-fx not found")
+    intf, ep = find_vendor_endpoint(dev)
+    if ep is None:
+        sys.exit("vendor interface not found")
+    usb.util.claim_interface(dev, intf.bInterfaceNumber)
+
+    current = read_params(dev, intf)
+    if not args.values and not args.save:
+        print(*current)
+        return
+    values = args.values + current[len(args.values):]
+
+    flags = FLAG_SAVE if args.save else 0
+    ep.write(COMMAND.pack(COMMAND_VERSION, flags, 0, *values), timeout=1000)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,170 @@
+/*
+ * Copyright 2025, Hiroyuki OYAMA
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+// Host benchmark: drives one effect with a held button for a few seconds of stereo tones and
+// reports its per-frame cost. Costs are host timer ticks (TSC on x86-64, ns elsewhere), so
+// they compare kernels and show how evenly work is spread, not absolute RP2040 cycles. The
+// run is repeated and each frame keeps its cheapest pass, which filters out host scheduling
+// noise while keeping any frame that is expensive every time.
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "fft.h"
+#include "fx.h"
+#include "grain.h"
+#include "meter.h"
+#include "perf.h"
+#include "ringbuffer.h"
+
+#define BENCH_FRAMES 4000
+#define BENCH_WARMUP_FRAMES 100  // capture and analysis, excluded from the steady-state figures
+#define BENCH_PASSES 5
+#define BENCH_FFT_RUNS 1000
+#define BENCH_GRAIN_RUNS 200
+#define BENCH_BAR_WIDTH 50
+
+static uint32_t frame_ticks[BENCH_FRAMES];
+
+uint32_t perf_cycles(void) {
+#if defined(__x86_64__)
+    return (uint32_t)__builtin_ia32_rdtsc();
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t)(ts.tv_sec * 1000000000ull + ts.tv_nsec);
+#endif
+}
+
+uint32_t perf_cycles_since(uint32_t start) { return perf_cycles() - start; }
+
+static void fill_frame(int32_t *frame, uint32_t frame_index) {
+    for (int i = 0; i < AUDIO_FRAME_SAMPLES; i++) {
+        double t = (double)(frame_index * AUDIO_FRAME_SAMPLES + i) / AUDIO_SAMPLE_RATE;
+        frame[i * 2 + 0] = (int32_t)(0.25 * sin(2 * M_PI * 440.0 * t) * 2147483647.0) & ~0xff;
+        frame[i * 2 + 1] = (int32_t)(0.25 * sin(2 * M_PI * 1000.0 * t) * 2147483647.0) & ~0xff;
+    }
+}
+
+static void bench_fft(void) {
+    static fft_complex_t data[FFT_SIZE];
+    fft_t fft;
+    uint64_t total = 0;
+
+    for (int run = 0; run < BENCH_FFT_RUNS; run++) {
+        for (int n = 0; n < FFT_SIZE; n++) {
+            data[n].re = (int32_t)(8000 * sin(2 * M_PI * 7 * n / FFT_SIZE));
+            data[n].im = (int32_t)(8000 * cos(2 * M_PI * 13 * n / FFT_SIZE));
+        }
+        fft_begin(&fft, data, run & 1);
+        uint32_t start = perf_cycles();
+        fft_run(&fft);
+        total += perf_cycles_since(start);
+    }
+    printf("fft%d: %llu ticks/transform, %llu ticks/step\n", FFT_SIZE,
+           (unsigned long long)(total / BENCH_FFT_RUNS),
+           (unsigned long long)(total / BENCH_FFT_RUNS / FFT_STEPS));
+}
+
+#ifdef FXBENCH_granular
+// Cost of rendering one frame against the number of active grains, as a text plot.
+static void bench_grains(void) {
+    static int16_t history[8192 * AUDIO_NUM_CHANNELS];
+    static int32_t mix[AUDIO_FRAME_SAMPLES * AUDIO_NUM_CHANNELS];
+    static uint32_t ticks[GRAIN_POOL_SIZE + 1];
+    grain_pool_t pool;
+
+    for (size_t i = 0; i < sizeof(history) / sizeof(history[0]); i++)
+        history[i] = (int16_t)(8000 * sin(i * 0.01));
+    for (int n = 0; n <= GRAIN_POOL_SIZE; n++) {
+        for (int run = 0; run < BENCH_GRAIN_RUNS; run++) {
+            grain_pool_reset(&pool);
+            for (int g = 0; g < n; g++) {
+                grain_t *grain = grain_alloc(&pool, GRAIN_POOL_SIZE);
+                grain->pos = (uint32_t)(g * 300) << 16;
+                grain->step = 65536;
+                grain->age = 0;
+            }
+            uint32_t start = perf_cycles();
+            grain_render(&pool, mix, history, 8192, AUDIO_FRAME_SAMPLES);
+            uint32_t t = perf_cycles_since(start);
+            if (run == 0 || t < ticks[n])
+                ticks[n] = t;
+        }
+    }
+
+    uint32_t scale = 1;
+    for (int n = 0; n <= GRAIN_POOL_SIZE; n++) {
+        if (ticks[n] > scale)
+            scale = ticks[n];
+    }
+    printf("grains  ticks/frame\n");
+    for (int n = 0; n <= GRAIN_POOL_SIZE; n++) {
+        int bar = (int)((uint64_t)ticks[n] * BENCH_BAR_WIDTH / scale);
+        printf("%6d  %11u  %.*s\n", n, ticks[n], bar,
+               "##################################################");
+    }
+}
+#endif
+
+// One pass from button press; returns the number of fx_status() steps past the warmup.
+static uint32_t bench_pass(int pass) {
+    static int32_t frame[AUDIO_FRAME_SAMPLES * AUDIO_NUM_CHANNELS];
+    uint32_t status_start = 0;
+
+    fx_set_enable(false);
+    fx_set_enable(true);
+    for (uint32_t f = 0; f < BENCH_FRAMES; f++) {
+        fill_frame(frame, f);
+        meter_begin_frame();
+        uint32_t start = perf_cycles();
+        fx_process((uint8_t *)frame, (uint8_t *)frame);
+        uint32_t ticks = perf_cycles_since(start);
+        meter_end_frame();
+
+        if (pass == 0 || ticks < frame_ticks[f])
+            frame_ticks[f] = ticks;
+        if (f == BENCH_WARMUP_FRAMES)
+            status_start = fx_status();
+    }
+    return fx_status() - status_start;
+}
+
+int main(void) {
+    uint32_t steps = 0;
+
+    fx_init();
+    bench_fft();
+#ifdef FXBENCH_granular
+    bench_grains();
+#endif
+    for (int pass = 0; pass < BENCH_PASSES; pass++)
+        steps = bench_pass(pass);
+
+    uint64_t total = 0;
+    uint32_t worst = 0, worst_frame = 0;
+    for (uint32_t f = BENCH_WARMUP_FRAMES; f < BENCH_FRAMES; f++) {
+        total += frame_ticks[f];
+        if (frame_ticks[f] > worst) {
+            worst = frame_ticks[f];
+            worst_frame = f;
+        }
+    }
+
+    uint32_t frames = BENCH_FRAMES - BENCH_WARMUP_FRAMES;
+    printf("%s: %llu ticks/frame avg, %u max (frame %u)\n", fx_name(),
+           (unsigned long long)(total / frames), worst, worst_frame);
+#if defined(FXBENCH_freeze)
+    if (steps)
+        printf("  %u hops, %llu ticks/hop\n", steps, (unsigned long long)(total / steps));
+#elif defined(FXBENCH_granular)
+    printf("  %u grains active at the end\n", fx_status());
+    (void)steps;
+#else
+    (void)steps;
+#endif
+    return 0;
+}
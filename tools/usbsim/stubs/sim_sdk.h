@@ -0,0 +1,113 @@
+/*
+ * Copyright 2025, Hiroyuki OYAMA
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+// The parts of pico-sdk and TinyUSB that src/main.c uses, reduced to what the simulator needs.
+// Everything declared here is implemented in usbsim.c.
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+typedef unsigned int uint;
+
+#define __no_inline_not_in_flash_func(name) name
+#define PICO_RP2040 1
+
+// pico/stdlib.h, hardware/sync.h, hardware/clocks.h
+typedef struct {
+    int unused;
+} repeating_timer_t;
+typedef bool (*repeating_timer_callback_t)(repeating_timer_t *rt);
+
+bool add_repeating_timer_ms(int32_t delay_ms, repeating_timer_callback_t callback,
+                            void *user_data, repeating_timer_t *out);
+uint32_t time_us_32(void);
+void stdio_init_all(void);
+uint32_t save_and_disable_interrupts(void);
+void restore_interrupts(uint32_t status);
+void __wfi(void);
+
+// hardware/gpio.h, hardware/structs/ioqspi.h: only reached by the BOOTSEL button read
+#define GPIO_OVERRIDE_NORMAL 0
+#define GPIO_OVERRIDE_LOW 2
+#define IO_QSPI_GPIO_QSPI_SS_CTRL_OEOVER_LSB 12
+#define IO_QSPI_GPIO_QSPI_SS_CTRL_OEOVER_BITS 0x00003000u
+typedef struct {
+    struct {
+        volatile uint32_t status, ctrl;
+    } io[6];
+} ioqspi_hw_t;
+typedef struct {
+    volatile uint32_t gpio_hi_in;
+} sio_hw_t;
+extern ioqspi_hw_t *ioqspi_hw;
+extern sio_hw_t *sio_hw;
+void hw_write_masked(volatile uint32_t *addr, uint32_t values, uint32_t write_mask);
+
+// hardware/structs/usb.h: the OUT buffer state and frame number read by the arrival stamp
+#define USB_SOF_RD_BITS 0x000007ffu
+#define USB_BUF_CTRL_AVAIL 0x00000400u
+typedef struct {
+    volatile uint32_t sof_rd;
+} usb_hw_t;
+typedef struct {
+    struct {
+        volatile uint32_t in, out;
+    } ep_buf_ctrl[16];
+} usb_device_dpram_t;
+extern usb_hw_t *usb_hw;
+extern usb_device_dpram_t *usb_dpram;
+
+// bsp/board_api.h
+#define BOARD_TUD_RHPORT 0
+void board_init(void);
+void board_init_after_tusb(void);
+
+// tusb.h
+typedef struct {
+    uint8_t role;
+    uint8_t speed;
+} tusb_rhport_init_t;
+enum { TUSB_ROLE_DEVICE = 1 };
+enum { TUSB_SPEED_AUTO = 0xff };
+
+typedef struct __attribute__((packed)) {
+    union {
+        struct __attribute__((packed)) {
+            uint8_t recipient : 5;
+            uint8_t type : 2;
+            uint8_t direction : 1;
+        } bmRequestType_bit;
+        uint8_t bmRequestType;
+    };
+    uint8_t bRequest;
+    uint16_t wValue;
+    uint16_t wIndex;
+    uint16_t wLength;
+} tusb_control_request_t;
+
+static inline uint16_t tu_le16toh(uint16_t v) { return v; }
+static inline uint8_t tu_u16_low(uint16_t v) { return (uint8_t)(v & 0xff); }
+
+enum { DCD_EVENT_XFER_COMPLETE = 7 };
+enum { CONTROL_STAGE_SETUP = 1 };
+enum { TUSB_REQ_TYPE_VENDOR = 2 };
+enum { TUSB_DIR_IN = 1 };
+
+bool tusb_init(uint8_t rhport, const tusb_rhport_init_t *rh_init);
+void tud_task(void);
+bool tud_task_event_ready(void);
+bool tud_mounted(void);
+uint16_t tud_audio_read(void *buffer, uint16_t bufsize);
+uint16_t tud_audio_write(const void *data, uint16_t len);
+bool tud_vendor_mounted(void);
+uint32_t tud_vendor_available(void);
+uint32_t tud_vendor_read(void *buffer, uint32_t bufsize);
+uint32_t tud_vendor_write_available(void);
+bool tud_control_xfer(uint8_t rhport, tusb_control_request_t const *request, void *buffer,
+                      uint16_t len);
+uint32_t tud_vendor_write(const void *buffer, uint32_t bufsize);
+uint32_t tud_vendor_write_flush(void);
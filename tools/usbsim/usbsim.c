@@ -0,0 +1,533 @@
+/*
+ * Copyright 2025, Hiroyuki OYAMA
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+// USB isochronous timing simulator. src/main.c is linked unchanged against the stubs in
+// stubs/, and its endpoint callbacks, audio_task() and control tick are driven on a virtual
+// 1 ms SOF timeline by a scripted host. Every OUT frame is tagged with its sequence number,
+// so the IN side shows exactly which frame left the device when: the report gives xruns, ring
+// occupancy and the latency the device adds, next to the latency it reports to the host. A
+// packet pre-loaded at one IN completion reaches the host on the next IN token.
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "clock_governor.h"
+#include "fx.h"
+#include "led.h"
+#include "perf.h"
+#include "preset.h"
+#include "ringbuffer.h"
+#include "tusb.h"
+#include "usb_descriptors.h"
+
+// Defined in src/main.c
+bool tud_audio_rx_done_pre_read_cb(uint8_t rhport, uint16_t n_bytes_received, uint8_t func_id,
+                                   uint8_t ep_out, uint8_t cur_alt_setting);
+bool tud_audio_tx_done_pre_load_cb(uint8_t rhport, uint8_t itf, uint8_t ep_in,
+                                   uint8_t cur_alt_setting);
+bool tud_audio_set_itf_close_EP_cb(uint8_t rhport, tusb_control_request_t const *p_request);
+bool tud_audio_set_itf_cb(uint8_t rhport, tusb_control_request_t const *p_request);
+void tud_event_hook_cb(uint8_t rhport, uint32_t eventid, bool in_isr);
+void audio_task(void);
+void control_task(void);
+void latency_task(void);
+
+#define SIM_SETTLE_TICKS 1000  // control ticks before streaming, so the effect reaches bypass
+#define SIM_MAX_EVENTS 64
+#define SIM_LATENCY_BUCKET_US 250
+#define SIM_LATENCY_BUCKETS 80
+#define SIM_BAR_WIDTH 40
+#define SIM_NOT_RECEIVED UINT32_MAX
+
+typedef struct {
+    const char *name;
+    const char *description;
+    uint32_t rx_offset_us;     // OUT completion callback after SOF
+    uint32_t tx_offset_us;     // IN pre-load callback after SOF
+    uint32_t jitter_us;        // extra dispatch delay on every callback, uniform
+    uint32_t burst_permille;   // chance per frame that the host starts holding back OUT packets
+    uint32_t burst_frames;     // packets held, then delivered back to back
+    uint32_t miss_permille;    // SOFs with neither an OUT packet nor an IN token
+    uint32_t restart_every;    // close and reopen both streams every this many frames
+    uint32_t restart_gap;      // frames the streams stay closed
+} scenario_t;
+
+static const scenario_t scenarios[] = {
+    {"ideal", "one OUT and one IN callback per SOF", 100, 500, 0, 0, 0, 0, 0, 0},
+    {"jitter", "up to 900 us dispatch jitter", 50, 50, 900, 0, 0, 0, 0, 0},
+    {"burst", "host holds back 4 OUT packets 1% of the time", 100, 500, 100, 10, 4, 0, 0, 0},
+    {"missed-sof", "1% of SOFs skipped", 100, 500, 100, 0, 0, 10, 0, 0},
+    {"restart", "streams closed for 50 ms every 2 s", 50, 50, 900, 0, 0, 0, 2000, 50},
+};
+#define NUM_SCENARIOS (sizeof(scenarios) / sizeof(scenarios[0]))
+
+typedef enum { EVENT_RX, EVENT_TX } event_type_t;
+
+typedef struct {
+    uint32_t time_us;
+    event_type_t type;
+    uint32_t seq;
+} event_t;
+
+typedef struct {
+    uint32_t host_sent;
+    uint32_t host_missed;
+    uint32_t rx_dropped;
+    uint32_t tx_frames;
+    uint32_t tx_underruns;
+    uint32_t discarded;  // received but skipped over on the IN side
+    uint32_t stale;      // sent after the stream it arrived on was closed
+    uint32_t occupancy[RINGBUF_FRAMES + 1];
+    uint32_t latency[SIM_LATENCY_BUCKETS + 1];
+    uint32_t latency_count;  // frames that reached the host
+    uint32_t latency_min;
+    uint32_t latency_max;
+    uint64_t latency_sum;
+    uint32_t fw_counters[PERF_NUM_COUNTERS];
+    uint32_t reported_min_ns;  // UAC2 latency control while streaming
+    uint32_t reported_max_ns;
+    uint32_t reported_changes;
+} sim_stats_t;
+
+static uint32_t now_us = 0;
+static uint32_t rng = 1;
+static sim_stats_t stats;
+
+// Per OUT sequence number
+static uint32_t *rx_time_us;
+static uint32_t *rx_session;
+static bool *tx_done;
+static uint32_t in_flight = SIM_NOT_RECEIVED;  // sequence number pre-loaded for the next IN token
+
+static uint8_t rx_packet[AUDIO_FRAME_BYTES];
+static bool rx_read;
+static uint8_t tx_packet[AUDIO_FRAME_BYTES];
+static uint32_t session = 0;
+static bool streaming = false;
+static uint32_t reported_latency_ns = 0;
+
+// ---- SDK and TinyUSB stubs ----------------------------------------------------------------
+
+static ioqspi_hw_t ioqspi_sim;
+static sio_hw_t sio_sim = {.gpio_hi_in = 1u << 1};  // BOOTSEL released
+ioqspi_hw_t *ioqspi_hw = &ioqspi_sim;
+sio_hw_t *sio_hw = &sio_sim;
+static usb_hw_t usb_sim;
+static usb_device_dpram_t usb_dpram_sim;
+usb_hw_t *usb_hw = &usb_sim;
+usb_device_dpram_t *usb_dpram = &usb_dpram_sim;
+
+void hw_write_masked(volatile uint32_t *addr, uint32_t values, uint32_t write_mask) {
+    *addr = (*addr & ~write_mask) | (values & write_mask);
+}
+
+bool add_repeating_timer_ms(int32_t delay_ms, repeating_timer_callback_t callback,
+                            void *user_data, repeating_timer_t *out) {
+    (void)delay_ms, (void)callback, (void)user_data, (void)out;
+    return true;
+}
+uint32_t time_us_32(void) { return now_us; }
+void stdio_init_all(void) {}
+uint32_t save_and_disable_interrupts(void) { return 0; }
+void restore_interrupts(uint32_t status) { (void)status; }
+void __wfi(void) {}
+void board_init(void) {}
+void board_init_after_tusb(void) {}
+bool tusb_init(uint8_t rhport, const tusb_rhport_init_t *rh_init) {
+    (void)rhport, (void)rh_init;
+    return true;
+}
+void tud_task(void) {}
+bool tud_task_event_ready(void) { return false; }
+bool tud_mounted(void) { return true; }
+
+uint16_t tud_audio_read(void *buffer, uint16_t bufsize) {
+    uint16_t n = bufsize < AUDIO_FRAME_BYTES ? bufsize : AUDIO_FRAME_BYTES;
+    memcpy(buffer, rx_packet, n);
+    rx_read = true;
+    return n;
+}
+
+uint16_t tud_audio_write(const void *data, uint16_t len) {
+    uint16_t n = len < AUDIO_FRAME_BYTES ? len : AUDIO_FRAME_BYTES;
+    memcpy(tx_packet, data, n);
+    return n;
+}
+
+bool tud_vendor_mounted(void) { return false; }
+uint32_t tud_vendor_available(void) { return 0; }
+uint32_t tud_vendor_read(void *buffer, uint32_t bufsize) {
+    (void)buffer, (void)bufsize;
+    return 0;
+}
+uint32_t tud_vendor_write_available(void) { return 0; }
+uint32_t tud_vendor_write(const void *buffer, uint32_t bufsize) {
+    (void)buffer, (void)bufsize;
+    return 0;
+}
+uint32_t tud_vendor_write_flush(void) { return 0; }
+bool tud_control_xfer(uint8_t rhport, tusb_control_request_t const *request, void *buffer,
+                      uint16_t len) {
+    (void)rhport, (void)request, (void)buffer, (void)len;
+    return true;
+}
+
+// ---- Firmware modules that need hardware ---------------------------------------------------
+
+void perf_init(void) {}
+uint32_t perf_cycles(void) { return 0; }
+uint32_t perf_cycles_since(uint32_t start) { return 0 - start; }
+void perf_record(perf_stat_id_t id, uint32_t value) { (void)id, (void)value; }
+void perf_count(perf_counter_id_t id) {
+    if (streaming)
+        stats.fw_counters[id]++;
+}
+void perf_report(void) {}
+
+void clock_governor_init(void) {}
+void clock_governor_reserve(uint32_t cycles) { (void)cycles; }
+void clock_governor_record(uint32_t dsp_cycles) { (void)dsp_cycles; }
+void clock_governor_update(void) {}
+uint32_t clock_governor_khz(void) { return 125000; }
+
+void usb_set_latency_ns(uint32_t latency_ns) {
+    if (latency_ns != reported_latency_ns)
+        stats.reported_changes++;
+    reported_latency_ns = latency_ns;
+}
+
+void led_set_blink_interval(uint32_t interval_ms) { (void)interval_ms; }
+void led_update(void) {}
+
+void preset_init(void) {}
+bool preset_load(fx_params_t *params) {
+    (void)params;
+    return false;
+}
+void preset_save(const fx_params_t *params) { (void)params; }
+void preset_task(bool audio_idle) { (void)audio_idle; }
+
+// ---- Host model ------------------------------------------------------------------------------
+
+static uint32_t random_below(uint32_t n) {
+    rng = rng * 1664525u + 1013904223u;
+    return n ? (rng >> 8) % n : 0;
+}
+
+static void set_interface(uint8_t itf, uint8_t alt) {
+    tusb_control_request_t request = {.bmRequestType = 0x01, .bRequest = 0x0b};
+    request.wValue = alt;
+    request.wIndex = itf;
+    // As in TinyUSB: the old endpoints are closed on every request, new ones opened for alt != 0
+    tud_audio_set_itf_close_EP_cb(0, &request);
+    if (alt != 0)
+        tud_audio_set_itf_cb(0, &request);
+}
+
+static void set_streaming(bool on) {
+    if (on == streaming)
+        return;
+    streaming = on;
+    if (on)
+        session++;
+    else
+        in_flight = SIM_NOT_RECEIVED;  // closing the IN endpoint drops the pre-loaded packet
+    // The OUT endpoint is armed when its alt setting opens, before tud_audio_set_itf_cb().
+    if (on)
+        usb_dpram->ep_buf_ctrl[EPNUM_AUDIO_OUT].out |= USB_BUF_CTRL_AVAIL;
+    else
+        usb_dpram->ep_buf_ctrl[EPNUM_AUDIO_OUT].out &= ~USB_BUF_CTRL_AVAIL;
+    set_interface(ITF_NUM_AUDIO_STREAMING_SPK, on ? 1 : 0);
+    set_interface(ITF_NUM_AUDIO_STREAMING_MIC, on ? 1 : 0);
+}
+
+static void deliver_rx(uint32_t seq) {
+    // Every sample carries seq + 1, so an all-zero frame on the IN side is the silence buffer.
+    int32_t tag = (int32_t)((seq + 1) << 8);
+    for (int i = 0; i < AUDIO_FRAME_SAMPLES * AUDIO_NUM_CHANNELS; i++)
+        memcpy(&rx_packet[i * AUDIO_BYTES_PER_SAMPLE], &tag, sizeof(tag));
+
+    // The transfer completes in the interrupt, which disarms the endpoint until TinyUSB re-arms
+    // it after the callback. Dispatch is modelled as immediate.
+    usb_dpram->ep_buf_ctrl[EPNUM_AUDIO_OUT].out &= ~USB_BUF_CTRL_AVAIL;
+    tud_event_hook_cb(0, DCD_EVENT_XFER_COMPLETE, true);
+    rx_read = false;
+    tud_audio_rx_done_pre_read_cb(0, AUDIO_FRAME_BYTES, 0, EPNUM_AUDIO_OUT, 1);
+    usb_dpram->ep_buf_ctrl[EPNUM_AUDIO_OUT].out |= USB_BUF_CTRL_AVAIL;
+    if (rx_read) {
+        rx_time_us[seq] = now_us;
+        rx_session[seq] = session;
+    } else {
+        stats.rx_dropped++;
+    }
+}
+
+static void record_latency(uint32_t latency) {
+    uint32_t bucket = latency / SIM_LATENCY_BUCKET_US;
+    stats.latency[bucket > SIM_LATENCY_BUCKETS ? SIM_LATENCY_BUCKETS : bucket]++;
+    stats.latency_sum += latency;
+    if (stats.latency_count++ == 0 || latency < stats.latency_min)
+        stats.latency_min = latency;
+    if (latency > stats.latency_max)
+        stats.latency_max = latency;
+}
+
+// An IN event is the completion of the packet pre-loaded at the previous one, followed by the
+// pre-load of the next packet.
+static void record_tx(uint32_t *in_device, uint32_t *next_unsent) {
+    if (in_flight != SIM_NOT_RECEIVED)
+        record_latency(now_us - rx_time_us[in_flight]);
+    in_flight = SIM_NOT_RECEIVED;
+
+    stats.occupancy[*in_device > RINGBUF_FRAMES ? RINGBUF_FRAMES : *in_device]++;
+
+    memset(tx_packet, 0, sizeof(tx_packet));
+    tud_event_hook_cb(0, DCD_EVENT_XFER_COMPLETE, true);
+    tud_audio_tx_done_pre_load_cb(0, ITF_NUM_AUDIO_STREAMING_MIC, EPNUM_AUDIO_IN | 0x80, 1);
+
+    int32_t tag;
+    memcpy(&tag, tx_packet, sizeof(tag));
+    if (tag == 0) {
+        stats.tx_underruns++;
+        return;
+    }
+    uint32_t seq = ((uint32_t)tag >> 8) - 1;
+    for (uint32_t s = *next_unsent; s < seq; s++) {
+        if (rx_time_us[s] != SIM_NOT_RECEIVED && !tx_done[s]) {
+            stats.discarded++;
+            (*in_device)--;
+        }
+    }
+    if (seq + 1 > *next_unsent)
+        *next_unsent = seq + 1;
+    if (rx_time_us[seq] == SIM_NOT_RECEIVED || tx_done[seq])
+        return;
+    tx_done[seq] = true;
+    (*in_device)--;
+
+    stats.tx_frames++;
+    if (rx_session[seq] != session)
+        stats.stale++;
+    in_flight = seq;
+}
+
+static void sort_events(event_t *events, int n) {
+    for (int i = 1; i < n; i++) {
+        event_t e = events[i];
+        int j = i;
+        for (; j > 0 && events[j - 1].time_us > e.time_us; j--)
+            events[j] = events[j - 1];
+        events[j] = e;
+    }
+}
+
+static void run_scenario(const scenario_t *sc, uint32_t frames) {
+    memset(&stats, 0, sizeof(stats));
+    rx_time_us = malloc(frames * sizeof(*rx_time_us));
+    rx_session = calloc(frames, sizeof(*rx_session));
+    tx_done = calloc(frames, sizeof(*tx_done));
+    for (uint32_t i = 0; i < frames; i++)
+        rx_time_us[i] = SIM_NOT_RECEIVED;
+
+    uint32_t held[SIM_MAX_EVENTS];
+    uint32_t n_held = 0, hold_left = 0;
+    uint32_t seq = 0, next_unsent = 0, in_device = 0;
+    uint32_t base_us = now_us;
+
+    for (uint32_t f = 0; f < frames; f++) {
+        uint32_t sof = base_us + f * 1000;
+        now_us = sof;
+        usb_hw->sof_rd = (usb_hw->sof_rd + 1) & USB_SOF_RD_BITS;
+        control_task();
+        latency_task();
+        if (streaming) {
+            if (stats.reported_max_ns == 0 || reported_latency_ns < stats.reported_min_ns)
+                stats.reported_min_ns = reported_latency_ns;
+            if (reported_latency_ns > stats.reported_max_ns)
+                stats.reported_max_ns = reported_latency_ns;
+        }
+
+        bool open = !(sc->restart_every && f % sc->restart_every >= sc->restart_every -
+                                                                   sc->restart_gap);
+        set_streaming(open);
+        if (!open) {
+            // Control and vendor transfers still complete while the audio stream is closed.
+            tud_event_hook_cb(0, DCD_EVENT_XFER_COMPLETE, true);
+            n_held = hold_left = 0;
+            continue;
+        }
+        if (random_below(1000) < sc->miss_permille) {
+            stats.host_missed++;
+            seq++;
+            continue;
+        }
+
+        event_t events[SIM_MAX_EVENTS];
+        int n = 0;
+        uint32_t this_seq = seq++;
+        stats.host_sent++;
+        if (hold_left == 0 && random_below(1000) < sc->burst_permille)
+            hold_left = sc->burst_frames;
+        if (hold_left > 0 && n_held < SIM_MAX_EVENTS - 2) {
+            held[n_held++] = this_seq;
+            hold_left--;
+        } else {
+            uint32_t t = sof + sc->rx_offset_us + random_below(sc->jitter_us + 1);
+            for (uint32_t i = 0; i < n_held; i++)
+                events[n++] = (event_t){t + i, EVENT_RX, held[i]};
+            events[n++] = (event_t){t + n_held, EVENT_RX, this_seq};
+            n_held = 0;
+        }
+        events[n++] =
+            (event_t){sof + sc->tx_offset_us + random_below(sc->jitter_us + 1), EVENT_TX, 0};
+        sort_events(events, n);
+
+        for (int i = 0; i < n; i++) {
+            now_us = events[i].time_us;
+            if (events[i].type == EVENT_RX) {
+                uint32_t dropped = stats.rx_dropped;
+                deliver_rx(events[i].seq);
+                if (stats.rx_dropped == dropped)
+                    in_device++;
+            } else {
+                record_tx(&in_device, &next_unsent);
+            }
+#ifdef FX_SCHED_POLLING
+            audio_task();
+#endif
+        }
+    }
+    set_streaming(false);
+    now_us = base_us + frames * 1000;
+
+    free(rx_time_us);
+    free(rx_session);
+    free(tx_done);
+}
+
+static void print_bar(uint32_t value, uint32_t total) {
+    int width = total ? (int)((uint64_t)value * SIM_BAR_WIDTH / total) : 0;
+    if (value && width == 0)
+        width = 1;
+    printf("%.*s\n", width, "########################################");
+}
+
+static void report(const scenario_t *sc, uint32_t frames, uint32_t seed) {
+    printf("== %s: %s (%u frames, seed %u)\n", sc->name, sc->description, frames, seed);
+    printf("  host sent %u OUT packets, skipped %u SOFs\n", stats.host_sent, stats.host_missed);
+    printf("  xruns: %u OUT dropped (ring full), %u IN underruns (silence sent)\n",
+           stats.rx_dropped, stats.tx_underruns);
+    printf("  firmware counters: rx_dropped %u, tx_underrun %u\n",
+           stats.fw_counters[PERF_COUNTER_RX_DROPPED], stats.fw_counters[PERF_COUNTER_TX_UNDERRUN]);
+    printf("  %u frames sent, %u discarded in the device, %u stale\n", stats.tx_frames,
+           stats.discarded, stats.stale);
+    if (stats.latency_count) {
+        printf("  added latency: min %u us, avg %llu us, max %u us\n", stats.latency_min,
+               (unsigned long long)(stats.latency_sum / stats.latency_count), stats.latency_max);
+    }
+    printf("  reported latency: %u-%u us, %u changes\n", stats.reported_min_ns / 1000,
+           stats.reported_max_ns / 1000, stats.reported_changes);
+
+    uint32_t samples = 0;
+    for (int i = 0; i <= RINGBUF_FRAMES; i++)
+        samples += stats.occupancy[i];
+    printf("  ring occupancy at IN pre-load (frames):\n");
+    for (int i = 0; i <= RINGBUF_FRAMES; i++) {
+        if (stats.occupancy[i] == 0)
+            continue;
+        printf("    %2d%s %7u  ", i, i == RINGBUF_FRAMES ? "+" : " ", stats.occupancy[i]);
+        print_bar(stats.occupancy[i], samples);
+    }
+    printf("  added latency (us):\n");
+    for (int i = 0; i <= SIM_LATENCY_BUCKETS; i++) {
+        if (stats.latency[i] == 0)
+            continue;
+        if (i == SIM_LATENCY_BUCKETS)
+            printf("    %5u+       %7u  ", i * SIM_LATENCY_BUCKET_US, stats.latency[i]);
+        else
+            printf("    %5u-%-5u  %7u  ", i * SIM_LATENCY_BUCKET_US,
+                   (i + 1) * SIM_LATENCY_BUCKET_US - 1, stats.latency[i]);
+        print_bar(stats.latency[i], stats.latency_count);
+    }
+    printf("\n");
+}
+
+static void usage(const char *argv0) {
+    fprintf(stderr,
+            "usage: %s [--frames N] [--seed N] [scenario...]\n"
+            "       %s [--frames N] [--seed N] --custom [--jitter US] [--burst PERMILLE]\n"
+            "          [--burst-frames N] [--miss PERMILLE] [--restart-every N] [--restart-gap N]\n"
+            "scenarios:",
+            argv0, argv0);
+    for (size_t i = 0; i < NUM_SCENARIOS; i++)
+        fprintf(stderr, " %s", scenarios[i].name);
+    fprintf(stderr, "\n");
+}
+
+int main(int argc, char **argv) {
+    static const struct option options[] = {
+        {"frames", required_argument, NULL, 'f'},
+        {"seed", required_argument, NULL, 's'},
+        {"custom", no_argument, NULL, 'c'},
+        {"jitter", required_argument, NULL, 'j'},
+        {"burst", required_argument, NULL, 'b'},
+        {"burst-frames", required_argument, NULL, 'B'},
+        {"miss", required_argument, NULL, 'm'},
+        {"restart-every", required_argument, NULL, 'r'},
+        {"restart-gap", required_argument, NULL, 'g'},
+        {"help", no_argument, NULL, 'h'},
+        {NULL, 0, NULL, 0},
+    };
+    scenario_t custom = {"custom", "from the command line", 100, 500, 0, 0, 4, 0, 0, 0};
+    bool use_custom = false;
+    uint32_t frames = 10000, seed = 1;
+
+    int opt;
+    while ((opt = getopt_long(argc, argv, "h", options, NULL)) != -1) {
+        uint32_t value = optarg ? (uint32_t)strtoul(optarg, NULL, 0) : 0;
+        switch (opt) {
+            case 'f': frames = value; break;
+            case 's': seed = value; break;
+            case 'c': use_custom = true; break;
+            case 'j': custom.jitter_us = value; break;
+            case 'b': custom.burst_permille = value; break;
+            case 'B': custom.burst_frames = value; break;
+            case 'm': custom.miss_permille = value; break;
+            case 'r': custom.restart_every = value; break;
+            case 'g': custom.restart_gap = value; break;
+            default: usage(argv[0]); return opt == 'h' ? 0 : 1;
+        }
+    }
+    if (frames == 0 || (custom.restart_every && custom.restart_gap >= custom.restart_every)) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    fx_init();
+    for (int i = 0; i < SIM_SETTLE_TICKS; i++) {
+        now_us += 1000;
+        tud_event_hook_cb(0, DCD_EVENT_XFER_COMPLETE, true);  // enumeration traffic
+        control_task();
+    }
+
+    if (use_custom) {
+        rng = seed;
+        run_scenario(&custom, frames);
+        report(&custom, frames, seed);
+        return 0;
+    }
+    for (size_t i = 0; i < NUM_SCENARIOS; i++) {
+        bool selected = optind >= argc;
+        for (int a = optind; a < argc; a++)
+            selected |= strcmp(argv[a], scenarios[i].name) == 0;
+        if (!selected)
+            continue;
+        rng = seed;
+        run_scenario(&scenarios[i], frames);
+        report(&scenarios[i], frames, seed);
+    }
+    return 0;
+}